@@ -47,10 +47,22 @@ int main(int argc, char *argv[]) {
 Application::Application(char *infile) {
 	int i;
 	par = new Params();
-	srand (time(NULL));
 	par->setparams(infile);
+	// Every random choice derives from this seed, so a run can be repeated with SEED
+	if ( par->SEED == 0 ) {
+		par->SEED = (unsigned int) time(NULL);
+	}
+	srand(par->SEED);
 	log = new Log(par);
-	en = new EmulNet(par);
+	if ( par->TRANSPORT == UDP_TRANSPORT ) {
+		en = new UdpNet(par);
+	}
+	else if ( par->TRANSPORT == SHM_TRANSPORT ) {
+		en = new ShmNet(par);
+	}
+	else {
+		en = new EmulNet(par);
+	}
 	mp1 = (MP1Node **) malloc(par->EN_GPSZ * sizeof(MP1Node *));
 
 	/*
@@ -67,12 +79,24 @@ Application::Application(char *infile) {
 		log->LOG(&(mp1[i]->getMemberNode()->addr), "APP");
 		delete addressOfMemberNode;
 	}
+
+	nthreads = (par->THREADS > 1) ? par->THREADS : 1;
+	phase = RECV_PHASE;
+	generation = 0;
+	running = 0;
+	for( i = 1; i < nthreads; i++ ) {
+		workers.push_back(thread(&Application::worker, this, i));
+	}
 }
 
 /**
  * Destructor
  */
 Application::~Application() {
+	runPhase(EXIT_PHASE);
+	for ( unsigned int i = 0; i < workers.size(); i++ ) {
+		workers[i].join();
+	}
 	delete log;
 	delete en;
 	for ( int i = 0; i < par->EN_GPSZ; i++ ) {
@@ -93,15 +117,17 @@ int Application::run()
 	int timeWhenAllNodesHaveJoined = 0;
 	// boolean indicating if all nodes have joined
 	bool allNodesJoined = false;
-	srand(time(NULL));
+	srand(par->SEED);
 
-	// As time runs along
-	for( par->globaltime = 0; par->globaltime < TOTAL_RUNNING_TIME; ++par->globaltime ) {
-		// Run the membership protocol
-		mp1Run();
-		// Fail some nodes
-		fail();
+	runTime = (par->RUN_TIME > 0) ? par->RUN_TIME : TOTAL_RUNNING_TIME;
+	failedAt.assign(par->EN_GPSZ, -1);
+	if ( par->SIM_MODE == EVENT_SIM ) {
+		runEvents();
+	}
+	else {
+		runTicks();
 	}
+	reportDetection();
 
 	// Clean up
 	en->ENcleanup();
@@ -114,52 +140,253 @@ int Application::run()
 }
 
 /**
- * FUNCTION NAME: mp1Run
+ * FUNCTION NAME: runTicks
  *
- * DESCRIPTION:	This function performs all the membership protocol functionalities
+ * DESCRIPTION: Visit every node at every tick
  */
-void Application::mp1Run() {
+void Application::runTicks() {
 	int i;
 
-	// For all the nodes in the system
-	for( i = 0; i <= par->EN_GPSZ-1; i++) {
+	due.clear();
+	for( i = par->EN_GPSZ - 1; i >= 0; i-- ) {
+		due.push_back(i);
+	}
 
-		/*
-		 * Receive messages from the network and queue them in the membership protocol queue
-		 */
-		if( par->getcurrtime() > (int)(par->STEP_RATE*i) && !(mp1[i]->getMemberNode()->bFailed) ) {
-			// Receive messages from the network and queue them
-			mp1[i]->recvLoop();
+	// As time runs along
+	for( par->globaltime = 0; par->globaltime < runTime; ++par->globaltime ) {
+		// Run the membership protocol
+		mp1Run();
+		// Fail some nodes
+		fail();
+	}
+}
+
+/**
+ * FUNCTION NAME: runEvents
+ *
+ * DESCRIPTION: Jump from one scheduled wake-up to the next, running only the nodes due.
+ * 				A node is due at its start time, the tick a message is delivered to it
+ * 				and whenever MP1Node::nextTick asks for; ticks nobody is due at are
+ * 				skipped. The same nodes do the same work at the same times as in
+ * 				runTicks, so the logs match for a given SEED.
+ */
+void Application::runEvents() {
+	int i, time;
+	SimEvent ev;
+	vector< pair<int, int> > receivers;
+
+	wakeAt.assign(par->EN_GPSZ, -1);
+	lastRun.assign(par->EN_GPSZ, -1);
+	for( i = 0; i < par->EN_GPSZ; i++ ) {
+		schedule(i, (int)(par->STEP_RATE*i));
+	}
+	post(DROP_START_TIME, -1, false);
+	post(FAIL_TIME, -1, false);
+	post(DROP_STOP_TIME, -1, false);
+	post(0, -1, false);
+
+	while ( !events.empty() && events.top().time < runTime ) {
+		time = events.top().time;
+
+		due.clear();
+		while ( !events.empty() && events.top().time == time ) {
+			ev = events.top();
+			events.pop();
+			i = ev.node;
+			if ( i < 0 ) {
+				if ( time % TIME_LOG_PERIOD == 0 ) {
+					post(time + TIME_LOG_PERIOD, -1, false);
+				}
+				continue;
+			}
+			// Skip timers replaced since, and nodes already due this tick
+			if ( (ev.timer && wakeAt[i] != time) || lastRun[i] == time ) {
+				continue;
+			}
+			due.push_back(i);
+			lastRun[i] = time;
 		}
+		sort(due.begin(), due.end(), greater<int>());
+
+		par->globaltime = time;
+		receivers.clear();
+		mp1Run(&receivers);
+		fail();
 
+		for( unsigned int k = 0; k < due.size(); k++ ) {
+			schedule(due[k], nextWake(due[k]));
+		}
+		// ENinit hands out ids from 1 in node order
+		for( unsigned int k = 0; k < receivers.size(); k++ ) {
+			post(receivers[k].second, receivers[k].first - 1, false);
+		}
 	}
 
-	// For all the nodes in the system
-	for( i = par->EN_GPSZ - 1; i >= 0; i-- ) {
+	par->globaltime = runTime;
+}
+
+/**
+ * FUNCTION NAME: post
+ *
+ * DESCRIPTION: Queue a wake-up of node at time, dropping those past the end of the run
+ */
+void Application::post(int time, int node, bool timer) {
+	if ( node >= par->EN_GPSZ || time < 0 || time >= runTime ) {
+		return;
+	}
+	SimEvent ev;
+	ev.time = time;
+	ev.node = node;
+	ev.timer = timer;
+	events.push(ev);
+}
+
+/**
+ * FUNCTION NAME: schedule
+ *
+ * DESCRIPTION: Set the timer of node i to time, replacing the previous one; -1 clears it
+ */
+void Application::schedule(int i, int time) {
+	wakeAt[i] = time;
+	post(time, i, true);
+}
+
+/**
+ * FUNCTION NAME: nextWake
+ *
+ * DESCRIPTION: Next time node i has work without being sent a message, -1 if none
+ */
+int Application::nextWake(int i) {
+	if ( par->getcurrtime() < (int)(par->STEP_RATE*i) ) {
+		return (int)(par->STEP_RATE*i);
+	}
+	return (int) mp1[i]->nextTick();
+}
+
+/**
+ * FUNCTION NAME: mp1Run
+ *
+ * DESCRIPTION:	This function performs all the membership protocol functionalities.
+ * 				Nodes only touch their own state while a phase runs: sends wait in
+ * 				per-node outboxes and log lines in per-node buffers, both written out
+ * 				afterwards in node order, so the outcome does not depend on THREADS.
+ */
+void Application::mp1Run(vector< pair<int, int> > *receivers) {
+	int i;
+
+	// Hand over messages whose network delay is up
+	en->ENtick();
+
+	log->setBuffered(true);
 
-		/*
-		 * Introduce nodes into the distributed system
-		 */
+	/*
+	 * Receive messages from the network and queue them in the membership protocol queue
+	 */
+	runPhase(RECV_PHASE);
+
+	/*
+	 * Introduce new nodes, handle all the messages in the queues and send heartbeats
+	 */
+	runPhase(PROCESS_PHASE);
+
+	log->setBuffered(false);
+
+	// For the nodes run, in the order they used to be run in
+	for( unsigned int k = 0; k < due.size(); k++ ) {
+		i = due[k];
 		if( par->getcurrtime() == (int)(par->STEP_RATE*i) ) {
-			// introduce the ith node into the system at time STEPRATE*i
-			mp1[i]->nodeStart(JOINADDR, par->PORTNUM);
 			cout<<i<<"-th introduced node is assigned with the address: "<<mp1[i]->getMemberNode()->addr.getAddress() << endl;
 			nodeCount += i;
 		}
 
-		/*
-		 * Handle all the messages in your queue and send heartbeats
-		 */
+		log->flushNode(*(int *)(mp1[i]->getMemberNode()->addr.addr));
+	}
+
+	#ifdef DEBUGLOG
+	if( (par->globaltime % TIME_LOG_PERIOD == 0) && par->getcurrtime() > 0 && !(mp1[0]->getMemberNode()->bFailed) ) {
+		log->LOG(&mp1[0]->getMemberNode()->addr, "@@time=%d", par->getcurrtime());
+	}
+	#endif
+
+	// Deliver everything sent during this tick
+	en->ENflush(receivers);
+}
+
+/**
+ * FUNCTION NAME: runShard
+ *
+ * DESCRIPTION: Run one phase of the tick for the due nodes assigned to worker w
+ */
+void Application::runShard(int phase, int w) {
+	int i;
+
+	for( unsigned int k = w; k < due.size(); k += nthreads ) {
+		i = due[k];
+		if ( phase == RECV_PHASE ) {
+			if( par->getcurrtime() > (int)(par->STEP_RATE*i) && !(mp1[i]->getMemberNode()->bFailed) ) {
+				// Receive messages from the network and queue them
+				mp1[i]->recvLoop();
+			}
+		}
+		else if( par->getcurrtime() == (int)(par->STEP_RATE*i) ) {
+			// introduce the ith node into the system at time STEPRATE*i
+			mp1[i]->nodeStart(JOINADDR, par->PORTNUM);
+		}
 		else if( par->getcurrtime() > (int)(par->STEP_RATE*i) && !(mp1[i]->getMemberNode()->bFailed) ) {
 			// handle messages and send heartbeats
 			mp1[i]->nodeLoop();
-			#ifdef DEBUGLOG
-			if( (i == 0) && (par->globaltime % 500 == 0) ) {
-				log->LOG(&mp1[i]->getMemberNode()->addr, "@@time=%d", par->getcurrtime());
-			}
-			#endif
 		}
+	}
+}
+
+/**
+ * FUNCTION NAME: runPhase
+ *
+ * DESCRIPTION: Run a phase on every worker, taking share 0 on the calling thread,
+ * 				and return once all of them are done
+ */
+void Application::runPhase(int phase) {
+	unique_lock<mutex> guard(phaseLock);
+	this->phase = phase;
+	generation++;
+	running = workers.size();
+	phaseStart.notify_all();
+	guard.unlock();
+
+	if ( phase == EXIT_PHASE ) {
+		return;
+	}
+	runShard(phase, 0);
+
+	guard.lock();
+	phaseDone.wait(guard, [this] { return running == 0; });
+}
+
+/**
+ * FUNCTION NAME: worker
+ *
+ * DESCRIPTION: Body of worker thread w: run each phase as it is started until EXIT_PHASE
+ */
+void Application::worker(int w) {
+	long seen = 0;
+	int current;
+
+	while ( true ) {
+		unique_lock<mutex> guard(phaseLock);
+		phaseStart.wait(guard, [this, seen] { return generation != seen; });
+		seen = generation;
+		current = phase;
+		guard.unlock();
+
+		if ( current == EXIT_PHASE ) {
+			return;
+		}
+		runShard(current, w);
 
+		guard.lock();
+		if ( --running == 0 ) {
+			phaseDone.notify_one();
+		}
 	}
 }
 
@@ -174,33 +401,96 @@ void Application::fail() {
 	int i, removed;
 
 	// fail half the members at time t=400
-	if( par->DROP_MSG && par->getcurrtime() == 50 ) {
+	if( par->DROP_MSG && par->getcurrtime() == DROP_START_TIME ) {
 		par->dropmsg = 1;
 	}
 
-	if( par->SINGLE_FAILURE && par->getcurrtime() == 100 ) {
+	if( par->SINGLE_FAILURE && par->getcurrtime() == FAIL_TIME ) {
 		removed = (rand() % par->EN_GPSZ);
 		#ifdef DEBUGLOG
 		log->LOG(&mp1[removed]->getMemberNode()->addr, "Node failed at time=%d", par->getcurrtime());
 		#endif
 		mp1[removed]->getMemberNode()->bFailed = true;
+		failedAt[removed] = par->getcurrtime();
 	}
-	else if( par->getcurrtime() == 100 ) {
+	else if( par->getcurrtime() == FAIL_TIME ) {
 		removed = rand() % par->EN_GPSZ/2;
 		for ( i = removed; i < removed + par->EN_GPSZ/2; i++ ) {
 			#ifdef DEBUGLOG
 			log->LOG(&mp1[i]->getMemberNode()->addr, "Node failed at time = %d", par->getcurrtime());
 			#endif
 			mp1[i]->getMemberNode()->bFailed = true;
+			failedAt[i] = par->getcurrtime();
 		}
 	}
 
-	if( par->DROP_MSG && par->getcurrtime() == 300) {
+	if( par->DROP_MSG && par->getcurrtime() == DROP_STOP_TIME) {
 		par->dropmsg=0;
 	}
 
 }
 
+/**
+ * FUNCTION NAME: reportDetection
+ *
+ * DESCRIPTION: Score the removals every node made against the failures fail() caused
+ * 				and write the result to stats.log: how many (running node, failed node)
+ * 				pairs ended in a removal and how long after the failure, and how many
+ * 				removals hit a node that was still running, as a share of node pairs
+ */
+void Application::reportDetection() {
+	int i, j, live = 0, detected = 0, worst = 0, falseRemovals = 0, falsePairs = 0;
+	long latency = 0;
+	char name[64];
+	vector<char> seen;
+
+	for ( i = 0; i < par->EN_GPSZ; i++ ) {
+		if ( failedAt[i] < 0 ) {
+			live++;
+		}
+	}
+
+	for ( i = 0; i < par->EN_GPSZ; i++ ) {
+		// 1 once node j was found failed, 2 once it was removed while running
+		seen.assign(par->EN_GPSZ, 0);
+		vector< pair<int, int> > &removals = mp1[i]->getRemovals();
+		for ( unsigned int k = 0; k < removals.size(); k++ ) {
+			// ENinit hands out ids from 1 in node order
+			j = removals[k].first - 1;
+			if ( j < 0 || j >= par->EN_GPSZ ) {
+				continue;
+			}
+			if ( failedAt[j] < 0 || removals[k].second < failedAt[j] ) {
+				falseRemovals++;
+				if ( !(seen[j] & 2) ) {
+					falsePairs++;
+				}
+				seen[j] |= 2;
+			}
+			else if ( failedAt[i] < 0 && !(seen[j] & 1) ) {
+				seen[j] |= 1;
+				detected++;
+				latency += removals[k].second - failedAt[j];
+				worst = max(worst, removals[k].second - failedAt[j]);
+			}
+		}
+	}
+
+	if ( par->PROTOCOL == SWIM ) {
+		sprintf(name, "SWIM");
+	}
+	else if ( par->FD_MODE == PHI_ACCRUAL ) {
+		sprintf(name, "phi accrual, threshold %.1f", par->PHI_THRESHOLD);
+	}
+	else {
+		sprintf(name, "fixed timeout of %d ticks", TFAIL + TREMOVE);
+	}
+	log->LOG(&mp1[0]->getMemberNode()->addr,
+			"#STATSLOG# failure detector %s: %d of %d failures detected, latency mean %.1f max %d ticks; %d false removals, %.2f%% of node pairs",
+			name, detected, live * (par->EN_GPSZ - live), detected ? (double)latency / detected : 0.0, worst,
+			falseRemovals, par->EN_GPSZ > 1 ? 100.0 * falsePairs / (par->EN_GPSZ * (par->EN_GPSZ - 1)) : 0.0);
+}
+
 /**
  * FUNCTION NAME: getjoinaddr
  *
@@ -13,6 +13,8 @@
 #include "Params.h"
 #include "Member.h"
 #include "EmulNet.h"
+#include "UdpNet.h"
+#include "ShmNet.h"
 #include "Queue.h"
 
 /**
@@ -25,6 +27,48 @@ int nodeCount = 0;
  */
 #define ARGS_COUNT 2
 #define TOTAL_RUNNING_TIME 700
+// times at which fail() starts dropping messages, fails nodes and stops dropping
+#define DROP_START_TIME 50
+#define FAIL_TIME 100
+#define DROP_STOP_TIME 300
+// ticks between the coordinator's @@time debug lines
+#define TIME_LOG_PERIOD 500
+
+/**
+ * Simulation engines, selected with SIM_MODE in the test case
+ */
+enum SimModes {
+	TICK_SIM,
+	EVENT_SIM
+};
+
+/**
+ * Phases of a tick, run by every worker thread over its share of the nodes
+ */
+enum TickPhases {
+	RECV_PHASE,
+	PROCESS_PHASE,
+	EXIT_PHASE
+};
+
+/**
+ * STRUCT NAME: SimEvent
+ *
+ * DESCRIPTION: Wake-up of the event-driven engine. Node -1 marks a time fail() or the
+ * 				time log acts at. A timer is the node's own next piece of work and is
+ * 				replaced by the next one scheduled; a delivery always stands.
+ */
+typedef struct SimEvent {
+	int time;
+	int node;
+	bool timer;
+	bool operator >(const SimEvent &other) const {
+		if ( time != other.time ) {
+			return time > other.time;
+		}
+		return node > other.node;
+	}
+}SimEvent;
 
 /**
  * CLASS NAME: Application
@@ -40,13 +84,41 @@ private:
     Log *log;
 	MP1Node **mp1;
 	Params *par;
+	// Worker threads; the k-th due node is run by thread k % nthreads, thread 0 being the caller
+	int nthreads;
+	vector<thread> workers;
+	mutex phaseLock;
+	condition_variable phaseStart;
+	condition_variable phaseDone;
+	int phase;
+	long generation;
+	int running;
+	// Ticks simulated, and the nodes to run this tick, highest index first
+	int runTime;
+	vector<int> due;
+	// Event-driven engine: pending wake-ups, the time of each node's current timer
+	// and the last time each node was run
+	priority_queue< SimEvent, vector<SimEvent>, greater<SimEvent> > events;
+	vector<int> wakeAt;
+	vector<int> lastRun;
+	// Global time each node was failed at, -1 for nodes still running
+	vector<int> failedAt;
+	void runTicks();
+	void runEvents();
+	void post(int time, int node, bool timer);
+	void schedule(int i, int time);
+	int nextWake(int i);
+	void runPhase(int phase);
+	void worker(int w);
+	void runShard(int phase, int w);
 public:
 	Application(char *);
 	virtual ~Application();
 	Address getjoinaddr();
 	int run();
-	void mp1Run();
+	void mp1Run(vector< pair<int, int> > *receivers = NULL);
 	void fail();
+	void reportDetection();
 };
 
 #endif /* _APPLICATION_H__ */
@@ -0,0 +1,236 @@
+/**********************************
+ * FILE NAME: Daemon.cpp
+ *
+ * DESCRIPTION: Standalone node process definition
+ **********************************/
+
+#include "Daemon.h"
+
+// Set by SIGINT/SIGTERM, checked once per tick
+volatile sig_atomic_t stopRequested = 0;
+
+void stopHandler(int sig) {
+	stopRequested = 1;
+}
+
+/**********************************
+ * FUNCTION NAME: main
+ *
+ * DESCRIPTION: Run one node until RUN_TIME ticks have passed, or until signalled if
+ * 				RUN_TIME is 0. Start several with the same test case to form a group.
+ **********************************/
+int main(int argc, char *argv[]) {
+	struct sigaction sa;
+
+	if ( argc != ARGS_COUNT ) {
+		cout<<"Configuration (i.e., *.conf) file File Required"<<endl;
+		return FAILURE;
+	}
+
+	// No SA_RESTART, so a signal interrupts the wait for the next tick
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = stopHandler;
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+
+	Daemon *daemon = new Daemon(argv[1]);
+	int ret = daemon->run();
+	delete daemon;
+
+	return ret;
+}
+
+/**
+ * Constructor of the Daemon class
+ */
+Daemon::Daemon(char *infile) {
+	char prefix[32];
+
+	par = new Params();
+	par->setparams(infile);
+	// Daemons started together must not share a seed
+	if ( par->SEED == 0 ) {
+		par->SEED = (unsigned int) time(NULL) ^ ((unsigned int) getpid() << 16);
+	}
+	srand(par->SEED);
+
+	en = NULL;
+	log = NULL;
+	mp1 = NULL;
+	timerfd = -1;
+	missed = 0;
+	overBudget = 0;
+	// SHM_KEY 0 would give this daemon a region of its own, where no group can form
+	if ( par->TRANSPORT != SHM_TRANSPORT || par->SHM_KEY <= 0 ) {
+		return;
+	}
+
+	en = new ShmNet(par);
+	Address *addressOfMemberNode = new Address();
+	addressOfMemberNode = (Address *) en->ENinit(addressOfMemberNode, par->PORTNUM);
+
+	// Every daemon writes its own logs
+	sprintf(prefix, "node%d-", *(int *)(addressOfMemberNode->addr));
+	par->LOG_PREFIX = prefix;
+	log = new Log(par);
+
+	Member *memberNode = new Member;
+	memberNode->inited = false;
+	mp1 = new MP1Node(memberNode, par, en, log, addressOfMemberNode);
+	log->LOG(&(mp1->getMemberNode()->addr), "APP");
+	delete addressOfMemberNode;
+}
+
+/**
+ * Destructor
+ */
+Daemon::~Daemon() {
+	if ( timerfd >= 0 ) {
+		close(timerfd);
+	}
+	delete mp1;
+	delete log;
+	delete en;
+	delete par;
+}
+
+/**
+ * FUNCTION NAME: since
+ *
+ * DESCRIPTION: Microseconds from from to to
+ */
+long Daemon::since(struct timespec *from, struct timespec *to) {
+	return (to->tv_sec - from->tv_sec) * 1000000L + (to->tv_nsec - from->tv_nsec) / 1000;
+}
+
+/**
+ * FUNCTION NAME: run
+ *
+ * DESCRIPTION: Start the node at tick 0, then run it once per timer expiration.
+ * 				Tick t is due at start + t * TICK_USEC; jitter is how late the
+ * 				process woke up for the latest tick due.
+ */
+int Daemon::run() {
+	struct itimerspec spec;
+	struct timespec woke, done;
+	uint64_t expirations;
+	long ticks = 0;
+
+	if ( mp1 == NULL && par->TRANSPORT != SHM_TRANSPORT ) {
+		cout<<"The daemon needs the shared-memory transport (TRANSPORT: 2)"<<endl;
+		return FAILURE;
+	}
+	if ( mp1 == NULL ) {
+		cout<<"The daemon needs a non-zero SHM_KEY, the same for every node of the group"<<endl;
+		return FAILURE;
+	}
+	if ( par->TICK_USEC <= 0 ) {
+		cout<<"TICK_USEC must be positive"<<endl;
+		return FAILURE;
+	}
+
+	timerfd = timerfd_create(CLOCK_MONOTONIC, 0);
+	if ( timerfd < 0 ) {
+		perror("Daemon timerfd_create");
+		return FAILURE;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	spec.it_interval.tv_sec = par->TICK_USEC / 1000000;
+	spec.it_interval.tv_nsec = (par->TICK_USEC % 1000000) * 1000L;
+	spec.it_value.tv_sec = start.tv_sec + spec.it_interval.tv_sec;
+	spec.it_value.tv_nsec = start.tv_nsec + spec.it_interval.tv_nsec;
+	if ( spec.it_value.tv_nsec >= 1000000000L ) {
+		spec.it_value.tv_sec++;
+		spec.it_value.tv_nsec -= 1000000000L;
+	}
+	if ( timerfd_settime(timerfd, TFD_TIMER_ABSTIME, &spec, NULL) < 0 ) {
+		perror("Daemon timerfd_settime");
+		return FAILURE;
+	}
+
+	par->globaltime = 0;
+	mp1->nodeStart((char *)JOINADDR, par->PORTNUM);
+	cout<<"node "<<mp1->getMemberNode()->addr.getAddress()<<" started, pid "<<getpid()<<endl;
+	en->ENflush();
+
+	while ( !stopRequested && (par->RUN_TIME <= 0 || ticks < par->RUN_TIME) ) {
+		if ( read(timerfd, &expirations, sizeof(expirations)) != sizeof(expirations) ) {
+			if ( errno == EINTR ) {
+				continue;
+			}
+			perror("Daemon read timerfd");
+			break;
+		}
+		clock_gettime(CLOCK_MONOTONIC, &woke);
+
+		ticks += expirations;
+		missed += expirations - 1;
+		jitter.push_back(since(&start, &woke) - ticks * par->TICK_USEC);
+
+		// The node replays the missed ticks itself; a gossip round or probe period that
+		// fell due in them runs once now
+		par->globaltime = (int) ticks;
+		en->ENtick();
+		if ( !mp1->getMemberNode()->bFailed ) {
+			mp1->recvLoop();
+			mp1->nodeLoop();
+		}
+		en->ENflush();
+
+		clock_gettime(CLOCK_MONOTONIC, &done);
+		busy.push_back(since(&woke, &done));
+		if ( busy.back() > par->TICK_USEC ) {
+			overBudget++;
+		}
+	}
+
+	en->ENcleanup();
+	mp1->finishUpThisNode();
+	report();
+
+	return SUCCESS;
+}
+
+/**
+ * FUNCTION NAME: summarize
+ *
+ * DESCRIPTION: Write mean, median, 99th percentile and maximum of samples
+ */
+void Daemon::summarize(FILE *fp, const char *name, vector<long> samples) {
+	long total = 0;
+
+	if ( samples.empty() ) {
+		return;
+	}
+	sort(samples.begin(), samples.end());
+	for ( unsigned int i = 0; i < samples.size(); i++ ) {
+		total += samples[i];
+	}
+	fprintf(fp, "%-8s mean %8.1f us  p50 %8ld us  p99 %8ld us  max %8ld us\n", name,
+			(double)total / samples.size(), samples[samples.size() / 2],
+			samples[samples.size() * 99 / 100], samples.back());
+}
+
+/**
+ * FUNCTION NAME: report
+ *
+ * DESCRIPTION: Write ticks.log, one line per tick run followed by a summary
+ */
+void Daemon::report() {
+	FILE *fp = fopen((par->LOG_PREFIX + TICKS_LOG).c_str(), "w");
+	if ( fp == NULL ) {
+		return;
+	}
+
+	fprintf(fp, "# run  jitter_us  busy_us\n");
+	for ( unsigned int i = 0; i < jitter.size(); i++ ) {
+		fprintf(fp, "%6u %10ld %8ld\n", i + 1, jitter[i], busy[i]);
+	}
+	fprintf(fp, "tick %d us, %ld ticks in %u runs, %ld missed, %ld over budget\n",
+			par->TICK_USEC, (long)par->globaltime, (unsigned int)jitter.size(), missed, overBudget);
+	summarize(fp, "jitter", jitter);
+	summarize(fp, "busy", busy);
+	fclose(fp);
+}
@@ -0,0 +1,60 @@
+/**********************************
+ * FILE NAME: Daemon.h
+ *
+ * DESCRIPTION: Standalone node process driven by the wall clock
+ **********************************/
+
+#ifndef _DAEMON_H_
+#define _DAEMON_H_
+
+#include "stdincludes.h"
+#include "MP1Node.h"
+#include "Log.h"
+#include "Params.h"
+#include "Member.h"
+#include "EmulNet.h"
+#include "ShmNet.h"
+#include <sys/timerfd.h>
+
+/*
+ * Macros
+ */
+#define ARGS_COUNT 2
+#define TICKS_LOG "ticks.log"
+#define JOINADDR "1:0"
+
+/**
+ * CLASS NAME: Daemon
+ *
+ * DESCRIPTION: Runs one MP1Node in a process of its own. Nodes in other processes are
+ * 				reached through the shared-memory transport under the same SHM_KEY; the
+ * 				first daemon to attach gets id 1 and is the introducer. A timerfd fires
+ * 				every TICK_USEC microseconds and each expiration is one tick. When the
+ * 				node overruns its budget the missed expirations are counted and the next
+ * 				tick catches up on them. How late each tick woke up (jitter) and how long
+ * 				the node took to run it go to ticks.log.
+ */
+class Daemon {
+private:
+	Params *par;
+	EmulNet *en;
+	Log *log;
+	MP1Node *mp1;
+	int timerfd;
+	struct timespec start;
+	// Per tick run, in microseconds
+	vector<long> jitter;
+	vector<long> busy;
+	// Ticks the timer expired for while the node was busy
+	long missed;
+	long overBudget;
+	static long since(struct timespec *from, struct timespec *to);
+	void summarize(FILE *fp, const char *name, vector<long> samples);
+public:
+	Daemon(char *infile);
+	virtual ~Daemon();
+	int run();
+	void report();
+};
+
+#endif /* _DAEMON_H_ */
@@ -12,17 +12,14 @@
 EmulNet::EmulNet(Params *p)
 {
 	//trace.funcEntry("EmulNet::EmulNet");
-	int i,j;
 	par = p;
 	emulnet.setNextId(1);
 	emulnet.settCurrBuffSize(0);
 	enInited=0;
-	for ( i = 0; i < MAX_NODES; i++ ) {
-		for ( j = 0; j < MAX_TIME; j++ ) {
-			sent_msgs[i][j] = 0;
-			recv_msgs[i][j] = 0;
-		}
-	}
+	delayedMsgs = 0;
+	delayedTicks = 0;
+	packedMsgs = 0;
+	packedEnvelopes = 0;
 	//trace.funcExit("EmulNet::EmulNet", SUCCESS);
 }
 
@@ -30,15 +27,17 @@ EmulNet::EmulNet(Params *p)
  * Copy constructor
  */
 EmulNet::EmulNet(EmulNet &anotherEmulNet) {
-	int i, j;
 	this->par = anotherEmulNet.par;
 	this->enInited = anotherEmulNet.enInited;
-	for ( i = 0; i < MAX_NODES; i++ ) {
-		for ( j = 0; j < MAX_TIME; j++ ) {
-			this->sent_msgs[i][j] = anotherEmulNet.sent_msgs[i][j];
-			this->recv_msgs[i][j] = anotherEmulNet.recv_msgs[i][j];
-		}
-	}
+	this->traffic = anotherEmulNet.traffic;
+	this->dropSeed = anotherEmulNet.dropSeed;
+	this->inflight = anotherEmulNet.inflight;
+	this->delaySeed = anotherEmulNet.delaySeed;
+	this->linkFree = anotherEmulNet.linkFree;
+	this->delayedMsgs = anotherEmulNet.delayedMsgs;
+	this->delayedTicks = anotherEmulNet.delayedTicks;
+	this->packedMsgs = anotherEmulNet.packedMsgs;
+	this->packedEnvelopes = anotherEmulNet.packedEnvelopes;
 	this->emulnet = anotherEmulNet.emulnet;
 }
 
@@ -46,15 +45,17 @@ EmulNet::EmulNet(EmulNet &anotherEmulNet) {
  * Assignment operator overloading
  */
 EmulNet& EmulNet::operator =(EmulNet &anotherEmulNet) {
-	int i, j;
 	this->par = anotherEmulNet.par;
 	this->enInited = anotherEmulNet.enInited;
-	for ( i = 0; i < MAX_NODES; i++ ) {
-		for ( j = 0; j < MAX_TIME; j++ ) {
-			this->sent_msgs[i][j] = anotherEmulNet.sent_msgs[i][j];
-			this->recv_msgs[i][j] = anotherEmulNet.recv_msgs[i][j];
-		}
-	}
+	this->traffic = anotherEmulNet.traffic;
+	this->dropSeed = anotherEmulNet.dropSeed;
+	this->inflight = anotherEmulNet.inflight;
+	this->delaySeed = anotherEmulNet.delaySeed;
+	this->linkFree = anotherEmulNet.linkFree;
+	this->delayedMsgs = anotherEmulNet.delayedMsgs;
+	this->delayedTicks = anotherEmulNet.delayedTicks;
+	this->packedMsgs = anotherEmulNet.packedMsgs;
+	this->packedEnvelopes = anotherEmulNet.packedEnvelopes;
 	this->emulnet = anotherEmulNet.emulnet;
 	return *this;
 }
@@ -73,48 +74,210 @@ void *EmulNet::ENinit(Address *myaddr, short port) {
 	// Initialize data structures for this member
 	*(int *)(myaddr->addr) = emulnet.nextid++;
     *(short *)(&myaddr->addr[4]) = 0;
+	addNode(*(int *)(myaddr->addr));
 	return myaddr;
 }
 
+/**
+ * FUNCTION NAME: addNode
+ *
+ * DESCRIPTION: Give node id its own inbox, outbox, traffic counters and random sequences
+ */
+void EmulNet::addNode(int id) {
+	if ( id >= (int)emulnet.inbox.size() ) {
+		emulnet.inbox.resize(id + 1);
+		emulnet.outbox.resize(id + 1);
+		traffic.resize(id + 1);
+		dropSeed.resize(id + 1);
+		delaySeed.resize(id + 1);
+		pendingBytes.resize(id + 1, 0);
+		pendingMsgs.resize(id + 1, 0);
+		openBatch.resize(id + 1, -1);
+	}
+	dropSeed[id] = (par->SEED ^ 0x5bd1e995) + id * 2654435761u;
+	delaySeed[id] = (par->SEED ^ 0x27d4eb2f) + id * 2246822519u;
+}
+
+/**
+ * FUNCTION NAME: admit
+ *
+ * DESCRIPTION: Whether a message of size bytes from src to dst goes out, or is refused
+ * 				or dropped. Draws from the sender's drop sequence once per destination.
+ */
+bool EmulNet::admit(int src, int dst, int size) {
+	// Only nodes handed out by ENinit have an inbox and an outbox
+	if( src <= 0 || src >= (int)emulnet.outbox.size() || dst <= 0 || dst >= (int)emulnet.inbox.size() ) {
+		return false;
+	}
+
+	int sendmsg = rand_r(&dropSeed[src]) % 100;
+
+	if( (size > ENmaxSize()) || (par->dropmsg && sendmsg < (int) (par->MSG_DROP_PROB * 100)) ) {
+		return false;
+	}
+	return true;
+}
+
+/**
+ * FUNCTION NAME: frameSize
+ *
+ * DESCRIPTION: Bytes a frame carrying a message of size bytes takes in a payload
+ */
+int EmulNet::frameSize(int size) {
+	return (int)sizeof(en_frame) + (size + EN_FRAME_ALIGN - 1) / EN_FRAME_ALIGN * EN_FRAME_ALIGN;
+}
+
+/**
+ * FUNCTION NAME: firstFrame
+ *
+ * DESCRIPTION: First frame of a payload
+ */
+en_frame *EmulNet::firstFrame(en_payload *payload) {
+	return (en_frame *)(payload + 1);
+}
+
+/**
+ * FUNCTION NAME: nextFrame
+ *
+ * DESCRIPTION: Frame after frame in the same payload
+ */
+en_frame *EmulNet::nextFrame(en_frame *frame) {
+	return (en_frame *)((char *)frame + frameSize(frame->size));
+}
+
+/**
+ * FUNCTION NAME: newPayload
+ *
+ * DESCRIPTION: Copy size bytes of data into a single frame payload held by refs envelopes
+ */
+en_payload *EmulNet::newPayload(char *data, int size, int refs) {
+	int bytes = frameSize(size);
+	en_payload *payload = (en_payload *)pool.alloc(sizeof(en_payload) + bytes);
+	new (&payload->refs) atomic<int>(refs);
+	payload->size = bytes;
+	payload->capacity = bytes;
+	payload->frames = 1;
+
+	en_frame *frame = firstFrame(payload);
+	frame->size = size;
+	frame->offset = sizeof(en_payload);
+	memcpy((char *)(frame + 1), data, size);
+	return payload;
+}
+
+/**
+ * FUNCTION NAME: rawPayload
+ *
+ * DESCRIPTION: Payload held by one envelope from the frames of a payload that came in
+ * 				over a transport, NULL if they do not add up to size bytes
+ */
+en_payload *EmulNet::rawPayload(char *frames, int size) {
+	en_payload *payload = (en_payload *)pool.alloc(sizeof(en_payload) + size);
+	new (&payload->refs) atomic<int>(1);
+	payload->size = size;
+	payload->capacity = size;
+	payload->frames = 0;
+	memcpy((char *)(payload + 1), frames, size);
+
+	// Frames sit at the same place in every payload, so only the sizes need checking.
+	// A size is bounded by the bytes left before frameSize pads it, which could overflow
+	int used = 0;
+	en_frame *frame = firstFrame(payload);
+	while ( used + (int)sizeof(en_frame) <= size && frame->size >= 0
+			&& frame->size <= size - used - (int)sizeof(en_frame) && used + frameSize(frame->size) <= size ) {
+		frame->offset = sizeof(en_payload) + used;
+		used += frameSize(frame->size);
+		payload->frames++;
+		frame = nextFrame(frame);
+	}
+	if ( used != size || payload->frames == 0 ) {
+		unref(payload);
+		return NULL;
+	}
+	return payload;
+}
+
+/**
+ * FUNCTION NAME: envelope
+ *
+ * DESCRIPTION: Envelope of payload from node id from to node id to
+ */
+en_msg EmulNet::envelope(int from, int to, en_payload *payload) {
+	en_msg em;
+	*(int *)(em.from.addr) = from;
+	*(short *)(&em.from.addr[4]) = 0;
+	*(int *)(em.to.addr) = to;
+	*(short *)(&em.to.addr[4]) = 0;
+	em.payload = payload;
+	return em;
+}
+
 /**
  * FUNCTION NAME: ENsend
  *
- * DESCRIPTION: EmulNet send function
+ * DESCRIPTION: EmulNet send function. The message waits in the sender's outbox
+ * 				until ENflush, so nodes running on different threads can send at once.
  *
  * RETURNS:
  * size
  */
 int EmulNet::ENsend(Address *myaddr, Address *toaddr, char *data, int size) {
-	en_msg *em;
-	static char temp[2048];
-	int sendmsg = rand() % 100;
+	int src = *(int *)(myaddr->addr);
+	int dst = *(int *)(toaddr->addr);
 
-	if( (emulnet.currbuffsize >= ENBUFFSIZE) || (size + (int)sizeof(en_msg) >= par->MAX_MSG_SIZE) || (par->dropmsg && sendmsg < (int) (par->MSG_DROP_PROB * 100)) ) {
+	if( !admit(src, dst, size) ) {
 		return 0;
 	}
 
-	em = (en_msg *)malloc(sizeof(en_msg) + size);
-	em->size = size;
-
-	memcpy(&(em->from.addr), &(myaddr->addr), sizeof(em->from.addr));
-	memcpy(&(em->to.addr), &(toaddr->addr), sizeof(em->from.addr));
-	memcpy(em + 1, data, size);
+	en_msg em;
+	em.from = *myaddr;
+	em.to = *toaddr;
+	em.payload = newPayload(data, size, 1);
+	emulnet.outbox[src].push_back(em);
 
-	emulnet.buff[emulnet.currbuffsize++] = em;
+	return size;
+}
 
+/**
+ * FUNCTION NAME: ENmulticast
+ *
+ * DESCRIPTION: Send the same message to every address of toaddrs. The bytes are copied
+ * 				once and the envelope of each destination points at them. Each destination
+ * 				is refused, dropped and accounted for exactly as by its own ENsend.
+ *
+ * RETURNS:
+ * number of destinations the message is on its way to
+ */
+int EmulNet::ENmulticast(Address *myaddr, vector<Address> &toaddrs, char *data, int size) {
 	int src = *(int *)(myaddr->addr);
-	int time = par->getcurrtime();
+	int queued = 0;
 
-	assert(src <= MAX_NODES);
-	assert(time < MAX_TIME);
+	if( src <= 0 || src >= (int)emulnet.outbox.size() ) {
+		return 0;
+	}
 
-	sent_msgs[src][time]++;
+	vector<en_msg> &out = emulnet.outbox[src];
+	size_t first = out.size();
+	for ( unsigned int k = 0; k < toaddrs.size(); k++ ) {
+		if( !admit(src, *(int *)(toaddrs[k].addr), size) ) {
+			continue;
+		}
+		en_msg em;
+		em.from = *myaddr;
+		em.to = toaddrs[k];
+		em.payload = NULL;
+		out.push_back(em);
+		queued++;
+	}
 
-	#ifdef DEBUGLOG
-		sprintf(temp, "Sending 4+%d B msg type %d to %d.%d.%d.%d:%d ", size-4, *(int *)data, toaddr->addr[0], toaddr->addr[1], toaddr->addr[2], toaddr->addr[3], *(short *)&toaddr->addr[4]);
-	#endif
+	if( queued > 0 ) {
+		en_payload *payload = newPayload(data, size, queued);
+		for ( size_t j = first; j < out.size(); j++ ) {
+			out[j].payload = payload;
+		}
+	}
 
-	return size;
+	return queued;
 }
 
 /**
@@ -126,11 +289,280 @@ int EmulNet::ENsend(Address *myaddr, Address *toaddr, char *data, int size) {
  * size
  */
 int EmulNet::ENsend(Address *myaddr, Address *toaddr, string data) {
-	char * str = (char *) malloc(data.length() * sizeof(char));
-	memcpy(str, data.c_str(), data.size());
-	int ret = this->ENsend(myaddr, toaddr, str, (data.length() * sizeof(char)));
-	free(str);
-	return ret;
+	return this->ENsend(myaddr, toaddr, (char *)data.data(), (data.length() * sizeof(char)));
+}
+
+/**
+ * FUNCTION NAME: ENflush
+ *
+ * DESCRIPTION: Move the messages sent this tick into the inboxes of their destinations.
+ * 				Called once per tick while no node is running. Senders are taken from the
+ * 				highest id down, the order Application runs nodes in, so inboxes end up
+ * 				exactly as if every send had been delivered immediately.
+ * 				With the latency model on, each message is instead held in the
+ * 				timing wheel until its delivery tick, see ENtick.
+ * 				When receivers is given, (node id, delivery tick) is appended for
+ * 				every message held back and for every inbox that became non-empty.
+ *
+ * RETURNS:
+ * number of messages delivered
+ */
+int EmulNet::ENflush(vector< pair<int, int> > *receivers) {
+	int i, dst, when, bytes, delivered = 0;
+	bool held = latencyModel();
+
+	emulnet.currbuffsize = 0;
+	for ( i = 0; i < (int)emulnet.inbox.size(); i++ ) {
+		emulnet.currbuffsize += emulnet.inbox[i].size();
+	}
+	emulnet.currbuffsize += inflight.size();
+
+	for ( i = (int)emulnet.outbox.size() - 1; i > 0; i-- ) {
+		if( par->COALESCE ) {
+			coalesce(i);
+		}
+		vector<en_msg> &out = emulnet.outbox[i];
+		for ( unsigned int j = 0; j < out.size(); j++ ) {
+			en_msg &em = out[j];
+			if( emulnet.currbuffsize >= ENBUFFSIZE ) {
+				unref(em.payload);
+				continue;
+			}
+			dst = *(int *)(em.to.addr);
+			bytes = accountSent(i, em.payload);
+			if( held ) {
+				when = par->getcurrtime() + 1 + delay(i, dst, bytes);
+				inflight.schedule(when, em);
+				if( receivers != NULL ) {
+					receivers->push_back(make_pair(dst, when));
+				}
+			}
+			else {
+				if( receivers != NULL && emulnet.inbox[dst].empty() ) {
+					receivers->push_back(make_pair(dst, par->getcurrtime() + 1));
+				}
+				emulnet.inbox[dst].push_back(em);
+			}
+			emulnet.currbuffsize++;
+			delivered++;
+		}
+		out.clear();
+	}
+
+	return delivered;
+}
+
+/**
+ * FUNCTION NAME: ENtick
+ *
+ * DESCRIPTION: Move messages whose delivery tick has come from the timing wheel to
+ * 				their inboxes. Called at the start of every tick that is run, before
+ * 				any node receives.
+ */
+void EmulNet::ENtick() {
+	inflight.advance(par->getcurrtime(), [this](en_msg &em) {
+		emulnet.inbox[*(int *)(em.to.addr)].push_back(em);
+	});
+}
+
+/**
+ * FUNCTION NAME: latencyModel
+ *
+ * DESCRIPTION: Whether any delay or bandwidth limit is configured
+ */
+bool EmulNet::latencyModel() {
+	return par->LATENCY_MEAN > 0 || par->LATENCY_JITTER > 0 || par->LINK_BANDWIDTH > 0;
+}
+
+/**
+ * FUNCTION NAME: delay
+ *
+ * DESCRIPTION: Ticks a message of size bytes from src to dst is held beyond the next tick:
+ * 				a draw from the LATENCY_DIST distribution plus the time it queues behind
+ * 				earlier messages on a link of LINK_BANDWIDTH bytes per tick
+ */
+int EmulNet::delay(int src, int dst, int size) {
+	double lat;
+	double u = (rand_r(&delaySeed[src]) + 0.5) / ((double)RAND_MAX + 1);
+
+	switch ( par->LATENCY_DIST ) {
+	case UNIFORM_LATENCY:
+		lat = par->LATENCY_MEAN + (2 * u - 1) * par->LATENCY_JITTER;
+		break;
+	case EXPONENTIAL_LATENCY:
+		lat = -par->LATENCY_MEAN * log(u);
+		break;
+	case NORMAL_LATENCY: {
+		// Box-Muller with a second draw
+		double v = (rand_r(&delaySeed[src]) + 0.5) / ((double)RAND_MAX + 1);
+		lat = par->LATENCY_MEAN + par->LATENCY_JITTER * sqrt(-2 * log(u)) * cos(2 * M_PI * v);
+		break;
+	}
+	default:
+		lat = par->LATENCY_MEAN;
+		break;
+	}
+	long ticks = (lat > 0) ? lround(lat) : 0;
+
+	if ( par->LINK_BANDWIDTH > 0 ) {
+		// A link carries one message at a time, starting when the previous one is through
+		double now = par->getcurrtime();
+		double &busy = linkFree[((long long)src << 32) | (unsigned int)dst];
+		busy = max(now, busy) + size / par->LINK_BANDWIDTH;
+		long queued = (long)ceil(busy) - (long)(now + 1);
+		if ( queued > 0 ) {
+			ticks += queued;
+		}
+	}
+
+	delayedMsgs++;
+	delayedTicks += ticks;
+	return ticks;
+}
+
+/**
+ * FUNCTION NAME: ENrelease
+ *
+ * DESCRIPTION: Give back a message handed out by ENrecv once the receiver is done with it.
+ * 				Receivers of a multicast may do so from different threads at once.
+ */
+void EmulNet::ENrelease(char *data) {
+	if ( data == NULL ) {
+		return;
+	}
+	en_frame *frame = (en_frame *)data - 1;
+	unref((en_payload *)((char *)frame - frame->offset));
+}
+
+/**
+ * FUNCTION NAME: unref
+ *
+ * DESCRIPTION: Drop one reference to payload, returning it to the pool with the last one
+ */
+void EmulNet::unref(en_payload *payload) {
+	if ( payload->refs.fetch_sub(1, memory_order_acq_rel) == 1 ) {
+		pool.free((char *)payload, sizeof(en_payload) + payload->capacity);
+	}
+}
+
+/**
+ * FUNCTION NAME: reportArrivals
+ *
+ * DESCRIPTION: Append the nodes in arrivals to receivers, due next tick, and start over.
+ * 				A transport calls it at the end of ENflush once it has polled for what came in,
+ * 				so a node is only woken for messages it can actually read.
+ */
+void EmulNet::reportArrivals(vector< pair<int, int> > *receivers) {
+	if ( receivers != NULL ) {
+		for ( unsigned int k = 0; k < arrivals.size(); k++ ) {
+			receivers->push_back(make_pair(arrivals[k], par->getcurrtime() + 1));
+		}
+	}
+	arrivals.clear();
+}
+
+/**
+ * FUNCTION NAME: accountSent
+ *
+ * DESCRIPTION: Count every message of payload as sent by src in the current tick
+ *
+ * RETURNS:
+ * bytes of the messages counted
+ */
+int EmulNet::accountSent(int src, en_payload *payload) {
+	int bytes = 0;
+	en_frame *frame = firstFrame(payload);
+	for ( int k = 0; k < payload->frames; k++ ) {
+		account(traffic[src].sent_msgs, traffic[src].sent_bytes, par->getcurrtime(), frame->size);
+		bytes += frame->size;
+		frame = nextFrame(frame);
+	}
+	return bytes;
+}
+
+/**
+ * FUNCTION NAME: coalesce
+ *
+ * DESCRIPTION: Pack the messages src sent to a destination this tick into as few envelopes
+ * 				as fit MAX_MSG_SIZE, in the order they were sent. A destination sent a single
+ * 				message keeps its envelope, so multicasts stay shared where they can.
+ */
+void EmulNet::coalesce(int src) {
+	vector<en_msg> &out = emulnet.outbox[src];
+	int limit = par->MAX_MSG_SIZE - 1 - (int)sizeof(en_payload);
+	int dst, bytes;
+
+	if ( out.size() < 2 ) {
+		return;
+	}
+
+	for ( unsigned int j = 0; j < out.size(); j++ ) {
+		dst = *(int *)(out[j].to.addr);
+		pendingBytes[dst] += out[j].payload->size;
+		pendingMsgs[dst]++;
+	}
+
+	vector<en_msg> packed;
+	packed.reserve(out.size());
+	for ( unsigned int j = 0; j < out.size(); j++ ) {
+		en_msg &em = out[j];
+		dst = *(int *)(em.to.addr);
+		bytes = em.payload->size;
+		if ( pendingMsgs[dst] == 1 && openBatch[dst] < 0 ) {
+			packed.push_back(em);
+			pendingBytes[dst] = 0;
+			pendingMsgs[dst] = 0;
+			continue;
+		}
+
+		en_payload *batch = (openBatch[dst] >= 0) ? packed[openBatch[dst]].payload : NULL;
+		if ( batch == NULL || batch->size + bytes > batch->capacity ) {
+			// Sized for everything still to go to dst, up to what one envelope may carry
+			int capacity = max(min(pendingBytes[dst], limit), bytes);
+			batch = (en_payload *)pool.alloc(sizeof(en_payload) + capacity);
+			new (&batch->refs) atomic<int>(1);
+			batch->size = 0;
+			batch->capacity = capacity;
+			batch->frames = 0;
+			openBatch[dst] = packed.size();
+			packed.push_back(envelope(src, dst, batch));
+			packedEnvelopes++;
+		}
+
+		// Outbox payloads hold a single frame
+		en_frame *frame = (en_frame *)((char *)(batch + 1) + batch->size);
+		memcpy((char *)frame, (char *)firstFrame(em.payload), bytes);
+		frame->offset = sizeof(en_payload) + batch->size;
+		batch->size += bytes;
+		batch->frames++;
+		packedMsgs++;
+		pendingBytes[dst] -= bytes;
+		pendingMsgs[dst]--;
+		unref(em.payload);
+	}
+
+	for ( unsigned int j = 0; j < packed.size(); j++ ) {
+		openBatch[*(int *)(packed[j].to.addr)] = -1;
+	}
+	out.swap(packed);
+}
+
+/**
+ * FUNCTION NAME: ENmaxSize
+ *
+ * DESCRIPTION: Largest message ENsend takes; it and its headers must stay below MAX_MSG_SIZE
+ */
+int EmulNet::ENmaxSize() {
+	return par->MAX_MSG_SIZE - 1 - (int)(sizeof(en_payload) + sizeof(en_frame));
+}
+
+/**
+ * FUNCTION NAME: getMsgPool
+ *
+ * DESCRIPTION: Pool that message buffers sent through this network should come from
+ */
+MsgPool *EmulNet::getMsgPool() {
+	return &pool;
 }
 
 /**
@@ -143,39 +575,61 @@ int EmulNet::ENsend(Address *myaddr, Address *toaddr, string data) {
  */
 int EmulNet::ENrecv(Address *myaddr, int (* enq)(void *, char *, int), struct timeval *t, int times, void *queue){
 	// times is always assumed to be 1
-	int i;
 	char* tmp;
 	int sz;
-	en_msg *emsg;
-
-	for( i = emulnet.currbuffsize - 1; i >= 0; i-- ) {
-		emsg = emulnet.buff[i];
-
-		if ( 0 == strcmp(emsg->to.addr, myaddr->addr) ) {
-			sz = emsg->size;
-			tmp = (char *) malloc(sz * sizeof(char));
-			memcpy(tmp, (char *)(emsg+1), sz);
+	int dst = *(int *)(myaddr->addr);
 
-			emulnet.buff[i] = emulnet.buff[emulnet.currbuffsize-1];
-			emulnet.currbuffsize--;
+	if( dst <= 0 || dst >= (int)emulnet.inbox.size() ) {
+		return 0;
+	}
 
-			(*enq)(queue, (char *)tmp, sz);
+	// Only this node's inbox is touched, drained in the order messages were sent.
+	// currbuffsize is recounted by ENflush, so receivers on different threads never share a counter
+	deque<en_msg> &box = emulnet.inbox[dst];
+	while( !box.empty() ) {
+		en_payload *payload = box.front().payload;
+		box.pop_front();
 
-			free(emsg);
+		// The envelope's reference is shared out among the messages it carries
+		if ( payload->frames > 1 ) {
+			payload->refs.fetch_add(payload->frames - 1, memory_order_relaxed);
+		}
 
-			int dst = *(int *)(myaddr->addr);
-			int time = par->getcurrtime();
+		// Hand each message over in place, shared with the other receivers of a multicast;
+		// the receiver gives it back through ENrelease
+		en_frame *frame = firstFrame(payload);
+		for ( int k = 0; k < payload->frames; k++ ) {
+			en_frame *next = nextFrame(frame);
+			sz = frame->size;
+			tmp = (char *)(frame + 1);
 
-			assert(dst <= MAX_NODES);
-			assert(time < MAX_TIME);
+			(*enq)(queue, tmp, sz);
 
-			recv_msgs[dst][time]++;
+			account(traffic[dst].recv_msgs, traffic[dst].recv_bytes, par->getcurrtime(), sz);
+			frame = next;
 		}
 	}
 
 	return 0;
 }
 
+/**
+ * FUNCTION NAME: account
+ *
+ * DESCRIPTION: Count one message of size bytes at the given tick, growing the columns as needed
+ */
+void EmulNet::account(vector<int> &msgs, vector<long> &bytes, int time, int size) {
+	if ( time < 0 ) {
+		return;
+	}
+	if ( time >= (int)msgs.size() ) {
+		msgs.resize(time + 1, 0);
+		bytes.resize(time + 1, 0);
+	}
+	msgs[time]++;
+	bytes[time] += size;
+}
+
 /**
  * FUNCTION NAME: ENcleanup
  *
@@ -185,36 +639,78 @@ int EmulNet::ENcleanup() {
 	emulnet.nextid=0;
 	int i, j;
 	int sent_total, recv_total;
+	long sent_bytes, recv_bytes;
+	int sent, recv;
+	long all_sent = 0, all_sent_bytes = 0;
+	int nodes = 0;
 
-	FILE* file = fopen("msgcount.log", "w+");
+	FILE* file = fopen((par->LOG_PREFIX + MSGCOUNT_LOG).c_str(), "w+");
 
-	while(emulnet.currbuffsize > 0) {
-		free(emulnet.buff[--emulnet.currbuffsize]);
+	for ( i = 0; i < (int)emulnet.inbox.size(); i++ ) {
+		while( !emulnet.inbox[i].empty() ) {
+			unref(emulnet.inbox[i].front().payload);
+			emulnet.inbox[i].pop_front();
+		}
+		for ( j = 0; j < (int)emulnet.outbox[i].size(); j++ ) {
+			unref(emulnet.outbox[i][j].payload);
+		}
+		emulnet.outbox[i].clear();
 	}
+	inflight.drain([this](en_msg &em) {
+		unref(em.payload);
+	});
+	emulnet.currbuffsize = 0;
 
-	for ( i = 1; i <= par->EN_GPSZ; i++ ) {
+	for ( i = 1; i <= par->EN_GPSZ && i < (int)traffic.size(); i++ ) {
+		en_traffic &t = traffic[i];
 		fprintf(file, "node %3d ", i);
 		sent_total = 0;
 		recv_total = 0;
+		sent_bytes = 0;
+		recv_bytes = 0;
 
 		for (j = 0; j < par->getcurrtime(); j++) {
+			sent = (j < (int)t.sent_msgs.size()) ? t.sent_msgs[j] : 0;
+			recv = (j < (int)t.recv_msgs.size()) ? t.recv_msgs[j] : 0;
+			sent_bytes += (j < (int)t.sent_bytes.size()) ? t.sent_bytes[j] : 0;
+			recv_bytes += (j < (int)t.recv_bytes.size()) ? t.recv_bytes[j] : 0;
 
-			sent_total += sent_msgs[i][j];
-			recv_total += recv_msgs[i][j];
+			sent_total += sent;
+			recv_total += recv;
 			if (i != 67) {
-				fprintf(file, " (%4d, %4d)", sent_msgs[i][j], recv_msgs[i][j]);
+				fprintf(file, " (%4d, %4d)", sent, recv);
 				if (j % 10 == 9) {
 					fprintf(file, "\n         ");
 				}
 			}
 			else {
-				fprintf(file, "special %4d %4d %4d\n", j, sent_msgs[i][j], recv_msgs[i][j]);
+				fprintf(file, "special %4d %4d %4d\n", j, sent, recv);
 			}
 		}
 		fprintf(file, "\n");
-		fprintf(file, "node %3d sent_total %6u  recv_total %6u\n\n", i, sent_total, recv_total);
+		fprintf(file, "node %3d sent_total %6u  recv_total %6u  sent_bytes %8ld  recv_bytes %8ld\n\n", i, sent_total, recv_total, sent_bytes, recv_bytes);
+
+		all_sent += sent_total;
+		all_sent_bytes += sent_bytes;
+		nodes++;
+	}
+
+	if ( nodes > 0 && par->getcurrtime() > 0 ) {
+		fprintf(file, "per node per tick: msgs %.3f bytes %.1f\n",
+				(double)all_sent / nodes / par->getcurrtime(), (double)all_sent_bytes / nodes / par->getcurrtime());
 	}
 
+	if ( delayedMsgs > 0 ) {
+		fprintf(file, "latency model: %ld messages held %.3f ticks on average beyond the next tick\n",
+				delayedMsgs, (double)delayedTicks / delayedMsgs);
+	}
+
+	if ( packedEnvelopes > 0 ) {
+		fprintf(file, "coalescing: %ld messages packed into %ld envelopes\n", packedMsgs, packedEnvelopes);
+	}
+
+	pool.printStats(file);
+
 	fclose(file);
 	return 0;
 }
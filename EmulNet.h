@@ -7,47 +7,113 @@
 #ifndef _EMULNET_H_
 #define _EMULNET_H_
 
-#define MAX_NODES 1000
-#define MAX_TIME 3600
 #define ENBUFFSIZE 30000
+#define MSGCOUNT_LOG "msgcount.log"
+// frames in a payload start at multiples of this
+#define EN_FRAME_ALIGN 8
 
 #include "stdincludes.h"
 #include "Params.h"
 #include "Member.h"
+#include "MsgPool.h"
+#include "TimerWheel.h"
+#include <atomic>
 
 using namespace std;
 
+/**
+ * Delivery delay distributions, selected with LATENCY_DIST in the test case
+ */
+enum LatencyDists {
+	CONSTANT_LATENCY,
+	UNIFORM_LATENCY,
+	EXPONENTIAL_LATENCY,
+	NORMAL_LATENCY
+};
+
+/**
+ * Transports behind the EmulNet interface, selected with TRANSPORT in the test case
+ */
+enum Transports {
+	EMULATED_TRANSPORT,
+	UDP_TRANSPORT,
+	SHM_TRANSPORT
+};
+
+/**
+ * Struct Name: en_payload
+ *
+ * DESCRIPTION: Bytes of one or more messages, shared read-only by every envelope of a
+ * 				multicast. Each message is an en_frame followed by its bytes; there are
+ * 				several only when COALESCE packed messages to one destination together.
+ * 				ENrecv hands out the bytes of each frame in place; each receiver gives
+ * 				them back through ENrelease and the last one returns the block to the pool.
+ */
+typedef struct en_payload {
+	// Envelopes and receivers still holding the bytes
+	atomic<int> refs;
+	// Bytes of frames after the struct, and bytes allocated for them
+	int size;
+	int capacity;
+	int frames;
+}en_payload;
+
+/**
+ * Struct Name: en_frame
+ *
+ * DESCRIPTION: Header of one message in a payload, padded to EN_FRAME_ALIGN.
+ * 				offset leads from the frame back to the start of its payload.
+ */
+typedef struct en_frame {
+	int size;
+	int offset;
+}en_frame;
+
 /**
  * Struct Name: en_msg
+ *
+ * DESCRIPTION: Envelope of one delivery, kept by value in the queues
  */
 typedef struct en_msg {
-	// Number of bytes after the class
-	int size;
 	// Source node
 	Address from;
 	// Destination node
 	Address to;
+	en_payload *payload;
 }en_msg;
 
+/**
+ * Struct Name: en_traffic
+ *
+ * DESCRIPTION: Per-tick message and byte counters of one node, grown as the run advances
+ */
+typedef struct en_traffic {
+	vector<int> sent_msgs;
+	vector<int> recv_msgs;
+	vector<long> sent_bytes;
+	vector<long> recv_bytes;
+}en_traffic;
+
 /**
  * Class Name: EM
  */
 class EM {
 public:
 	int nextid;
+	// Total number of messages in flight across all inboxes
 	int currbuffsize;
 	int firsteltindex;
-	en_msg* buff[ENBUFFSIZE];
+	// Per-destination FIFO inboxes, indexed by node id
+	vector< deque<en_msg> > inbox;
+	// Messages sent during the current tick, indexed by sender id, moved to the inboxes by ENflush
+	vector< vector<en_msg> > outbox;
 	EM() {}
 	EM& operator = (EM &anotherEM) {
 		this->nextid = anotherEM.getNextId();
 		this->currbuffsize = anotherEM.getCurrBuffSize();
 		this->firsteltindex = anotherEM.getFirstEltIndex();
-		int i = this->currbuffsize;
-		while (i > 0) {
-			this->buff[i] = anotherEM.buff[i];
-			i--;
-		}
+		this->inbox = anotherEM.inbox;
+		this->outbox = anotherEM.outbox;
 		return *this;
 	}
 	int getNextId() {
@@ -78,22 +144,64 @@ public:
  */
 class EmulNet
 { 	
-private:
+protected:
 	Params* par;
-	int sent_msgs[MAX_NODES + 1][MAX_TIME];
-	int recv_msgs[MAX_NODES + 1][MAX_TIME];
+	// Traffic counters indexed by node id
+	vector<en_traffic> traffic;
+	// Per-sender random state for message drops, so results do not depend on thread scheduling
+	vector<unsigned int> dropSeed;
+	// Latency model: messages held until their delivery tick, per-sender random state
+	// for delays, and the time each link (sender id << 32 | receiver id) is busy until
+	TimerWheel<en_msg> inflight;
+	vector<unsigned int> delaySeed;
+	unordered_map<long long, double> linkFree;
+	// Messages that went through the latency model and the ticks they were held in total
+	long delayedMsgs;
+	long delayedTicks;
+	// Coalescing: frame bytes and messages still to pack per destination, the batch being
+	// filled for it, messages packed and envelopes they went out in
+	vector<int> pendingBytes;
+	vector<int> pendingMsgs;
+	vector<int> openBatch;
+	long packedMsgs;
+	long packedEnvelopes;
+	// Transports that take deliveries off sockets or rings: nodes handed messages since the last ENflush
+	vector<int> arrivals;
+	bool latencyModel();
+	int delay(int src, int dst, int size);
 	int enInited;
 	EM emulnet;
+	// Buffers for en_msg envelopes and protocol messages
+	MsgPool pool;
+	void account(vector<int> &msgs, vector<long> &bytes, int time, int size);
+	void addNode(int id);
+	bool admit(int src, int dst, int size);
+	en_payload *newPayload(char *data, int size, int refs);
+	en_payload *rawPayload(char *frames, int size);
+	en_msg envelope(int from, int to, en_payload *payload);
+	void unref(en_payload *payload);
+	int accountSent(int src, en_payload *payload);
+	void coalesce(int src);
+	void reportArrivals(vector< pair<int, int> > *receivers);
+	static int frameSize(int size);
+	static en_frame *firstFrame(en_payload *payload);
+	static en_frame *nextFrame(en_frame *frame);
 public:
  	EmulNet(Params *p);
  	EmulNet(EmulNet &anotherEmulNet);
  	EmulNet& operator = (EmulNet &anotherEmulNet);
  	virtual ~EmulNet();
-	void *ENinit(Address *myaddr, short port);
+	virtual void *ENinit(Address *myaddr, short port);
 	int ENsend(Address *myaddr, Address *toaddr, string data);
-	int ENsend(Address *myaddr, Address *toaddr, char *data, int size);
-	int ENrecv(Address *myaddr, int (* enq)(void *, char *, int), struct timeval *t, int times, void *queue);
-	int ENcleanup();
+	virtual int ENsend(Address *myaddr, Address *toaddr, char *data, int size);
+	virtual int ENmulticast(Address *myaddr, vector<Address> &toaddrs, char *data, int size);
+	virtual int ENrecv(Address *myaddr, int (* enq)(void *, char *, int), struct timeval *t, int times, void *queue);
+	virtual void ENtick();
+	virtual int ENflush(vector< pair<int, int> > *receivers = NULL);
+	virtual void ENrelease(char *data);
+	MsgPool *getMsgPool();
+	int ENmaxSize();
+	virtual int ENcleanup();
 };
 
 #endif /* _EMULNET_H_ */
@@ -12,6 +12,12 @@
 Log::Log(Params *p) {
 	par = p;
 	firstTime = false;
+	fp = NULL;
+	fp2 = NULL;
+	numwrites = 0;
+	buffered = false;
+	dbgPending.resize(par->EN_GPSZ + 1);
+	statsPending.resize(par->EN_GPSZ + 1);
 }
 
 /**
@@ -20,6 +26,12 @@ Log::Log(Params *p) {
 Log::Log(const Log &anotherLog) {
 	this->par = anotherLog.par;
 	this->firstTime = anotherLog.firstTime;
+	this->fp = anotherLog.fp;
+	this->fp2 = anotherLog.fp2;
+	this->numwrites = anotherLog.numwrites;
+	this->buffered = anotherLog.buffered;
+	this->dbgPending = anotherLog.dbgPending;
+	this->statsPending = anotherLog.statsPending;
 }
 
 /**
@@ -28,6 +40,12 @@ Log::Log(const Log &anotherLog) {
 Log& Log::operator = (const Log& anotherLog) {
 	this->par = anotherLog.par;
 	this->firstTime = anotherLog.firstTime;
+	this->fp = anotherLog.fp;
+	this->fp2 = anotherLog.fp2;
+	this->numwrites = anotherLog.numwrites;
+	this->buffered = anotherLog.buffered;
+	this->dbgPending = anotherLog.dbgPending;
+	this->statsPending = anotherLog.statsPending;
 	return *this;
 }
 
@@ -37,44 +55,26 @@ Log& Log::operator = (const Log& anotherLog) {
 Log::~Log() {}
 
 /**
- * FUNCTION NAME: LOG
+ * FUNCTION NAME: open
  *
- * DESCRIPTION: Print out to file dbg.log, along with Address of node.
+ * DESCRIPTION: Create dbg.log and stats.log on first use
  */
-void Log::LOG(Address *addr, const char * str, ...) {
-
-	static FILE *fp;
-	static FILE *fp2;
-	va_list vararglist;
-	static char buffer[30000];
-	static int numwrites;
-	static char stdstring[30];
-	static char stdstring2[40];
-	static char stdstring3[40]; 
-	static int dbg_opened=0;
-
-	if(dbg_opened != 639){
-		numwrites=0;
-
-		stdstring2[0]=0;
-
-		strcpy(stdstring3, stdstring2);
-
-		strcat(stdstring2, DBG_LOG);
-		strcat(stdstring3, STATS_LOG);
-
-		fp = fopen(stdstring2, "w");
-		fp2 = fopen(stdstring3, "w");
-
-		dbg_opened=639;
+void Log::open() {
+	if ( fp != NULL ) {
+		return;
 	}
-	else 
-
-	sprintf(stdstring, "%d.%d.%d.%d:%d ", addr->addr[0], addr->addr[1], addr->addr[2], addr->addr[3], *(short *)&addr->addr[4]);
+	fp = fopen((par->LOG_PREFIX + DBG_LOG).c_str(), "w");
+	fp2 = fopen((par->LOG_PREFIX + STATS_LOG).c_str(), "w");
+	numwrites = 0;
+}
 
-	va_start(vararglist, str);
-	vsprintf(buffer, str, vararglist);
-	va_end(vararglist);
+/**
+ * FUNCTION NAME: write
+ *
+ * DESCRIPTION: Append one formatted line to dbg.log, or stats.log if stats is set
+ */
+void Log::write(bool stats, const char *line) {
+	open();
 
 	if (!firstTime) {
 		int magicNumber = 0;
@@ -87,25 +87,75 @@ void Log::LOG(Address *addr, const char * str, ...) {
 		firstTime = true;
 	}
 
-	if(memcmp(buffer, "#STATSLOG#", 10)==0){
-		fprintf(fp2, "\n %s", stdstring);
-		fprintf(fp2, "[%d] ", par->getcurrtime());
-
-		fprintf(fp2, buffer);
-	}
-	else{
-		fprintf(fp, "\n %s", stdstring);
-		fprintf(fp, "[%d] ", par->getcurrtime());
-		fprintf(fp, buffer);
-
-	}
+	fputs(line, stats ? fp2 : fp);
 
 	if(++numwrites >= MAXWRITES){
 		fflush(fp);
 		fflush(fp2);
 		numwrites=0;
 	}
+}
+
+/**
+ * FUNCTION NAME: LOG
+ *
+ * DESCRIPTION: Print out to file dbg.log, along with Address of node.
+ * 				While buffered the line is kept with the node's other output
+ * 				until flushNode, so nodes may log from different threads.
+ */
+void Log::LOG(Address *addr, const char * str, ...) {
+
+	va_list vararglist;
+	char buffer[30000];
+	char line[30100];
+	char stdstring[30];
+
+	snprintf(stdstring, sizeof(stdstring), "%d.%d.%d.%d:%d ", addr->addr[0], addr->addr[1], addr->addr[2], addr->addr[3], *(short *)&addr->addr[4]);
+
+	va_start(vararglist, str);
+	vsnprintf(buffer, sizeof(buffer), str, vararglist);
+	va_end(vararglist);
+
+	bool stats = (memcmp(buffer, "#STATSLOG#", 10)==0);
+	snprintf(line, sizeof(line), "\n %s[%d] %s", stdstring, par->getcurrtime(), buffer);
+
+	int id = *(int *)(addr->addr);
+	if ( buffered && id >= 0 && id < (int)dbgPending.size() ) {
+		(stats ? statsPending : dbgPending)[id] += line;
+		return;
+	}
 
+	lock_guard<mutex> guard(writeLock);
+	write(stats, line);
+}
+
+/**
+ * FUNCTION NAME: setBuffered
+ *
+ * DESCRIPTION: Turn per-node buffering on while nodes run in parallel, off otherwise
+ */
+void Log::setBuffered(bool on) {
+	buffered = on;
+}
+
+/**
+ * FUNCTION NAME: flushNode
+ *
+ * DESCRIPTION: Write out the lines buffered for node id
+ */
+void Log::flushNode(int id) {
+	if ( id < 0 || id >= (int)dbgPending.size() ) {
+		return;
+	}
+	lock_guard<mutex> guard(writeLock);
+	if ( !dbgPending[id].empty() ) {
+		write(false, dbgPending[id].c_str());
+		dbgPending[id].clear();
+	}
+	if ( !statsPending[id].empty() ) {
+		write(true, statsPending[id].c_str());
+		statsPending[id].clear();
+	}
 }
 
 /**
@@ -114,8 +164,8 @@ void Log::LOG(Address *addr, const char * str, ...) {
  * DESCRIPTION: To Log a node add
  */
 void Log::logNodeAdd(Address *thisNode, Address *addedAddr) {
-	static char stdstring[100];
-	sprintf(stdstring, "Node %d.%d.%d.%d:%d joined at time %d", addedAddr->addr[0], addedAddr->addr[1], addedAddr->addr[2], addedAddr->addr[3], *(short *)&addedAddr->addr[4], par->getcurrtime());
+	char stdstring[100];
+	snprintf(stdstring, sizeof(stdstring), "Node %d.%d.%d.%d:%d joined at time %d", addedAddr->addr[0], addedAddr->addr[1], addedAddr->addr[2], addedAddr->addr[3], *(short *)&addedAddr->addr[4], par->getcurrtime());
     LOG(thisNode, stdstring);
 }
 
@@ -125,7 +175,7 @@ void Log::logNodeAdd(Address *thisNode, Address *addedAddr) {
  * DESCRIPTION: To log a node remove
  */
 void Log::logNodeRemove(Address *thisNode, Address *removedAddr) {
-	static char stdstring[30];
-	sprintf(stdstring, "Node %d.%d.%d.%d:%d removed at time %d", removedAddr->addr[0], removedAddr->addr[1], removedAddr->addr[2], removedAddr->addr[3], *(short *)&removedAddr->addr[4], par->getcurrtime());
+	char stdstring[100];
+	snprintf(stdstring, sizeof(stdstring), "Node %d.%d.%d.%d:%d removed at time %d", removedAddr->addr[0], removedAddr->addr[1], removedAddr->addr[2], removedAddr->addr[3], *(short *)&removedAddr->addr[4], par->getcurrtime());
     LOG(thisNode, stdstring);
 }
@@ -29,6 +29,17 @@ class Log{
 private:
 	Params *par;
 	bool firstTime;
+	FILE *fp;
+	FILE *fp2;
+	int numwrites;
+	// While buffered, lines are held per node id until flushNode writes them
+	bool buffered;
+	vector<string> dbgPending;
+	vector<string> statsPending;
+	// Serializes writes from nodes without a buffer of their own
+	mutex writeLock;
+	void open();
+	void write(bool stats, const char *line);
 public:
 	Log(Params *p);
 	Log(const Log &anotherLog);
@@ -37,6 +48,8 @@ public:
 	void LOG(Address *, const char * str, ...);
 	void logNodeAdd(Address *, Address *);
 	void logNodeRemove(Address *, Address *);
+	void setBuffered(bool on);
+	void flushNode(int id);
 };
 
 #endif /* _LOG_H_ */
@@ -25,6 +25,19 @@ MP1Node::MP1Node(Member *member, Params *params, EmulNet *emul, Log *log, Addres
 	this->log = log;
 	this->par = params;
 	this->memberNode->addr = *address;
+	this->peerCursor = 0;
+	this->tableVersion = 0;
+	this->fullPayloadStale = true;
+	this->gossipRound = 0;
+	this->incarnation = 0;
+	this->probeSeq = 0;
+	this->probeStart = 0;
+	this->probeActive = false;
+	this->probeAcked = false;
+	this->probeIndirect = false;
+	this->rngSeed = par->SEED + *(int *)(address->addr);
+	this->lastTick = 0;
+	this->phiDeviations = phiQuantile(par->PHI_THRESHOLD);
 }
 
 /**
@@ -67,6 +80,7 @@ int MP1Node::enqueueWrapper(void *env, char *buff, int size) {
 void MP1Node::nodeStart(char *servaddrstr, short servport) {
     Address joinaddr;
     joinaddr = getJoinAddress();
+    lastTick = par->getcurrtime();
 
     // Self booting routines
     if( initThisNode(&joinaddr) == -1 ) {
@@ -107,11 +121,11 @@ int MP1Node::initThisNode(Address *joinaddr) {
 	memberNode->heartbeat = 0;
 	memberNode->pingCounter = TFAIL;
 	memberNode->timeOutCounter = -1;
+	incarnation = 0;
+	probeActive = false;
     initMemberListTable(memberNode);
 
     addMember(id, port, memberNode->heartbeat);
-    
-    memberNode->myPos = memberNode->memberList.begin();
 
     return 0;
 }
@@ -124,7 +138,7 @@ int MP1Node::initThisNode(Address *joinaddr) {
 int MP1Node::introduceSelfToGroup(Address *joinaddr) {
 	MessageHdr *msg;
 #ifdef DEBUGLOG
-    static char s[1024];
+    char s[1024];
 #endif
 
     if ( 0 == memcmp((char *)&(memberNode->addr.addr), (char *)&(joinaddr->addr), sizeof(memberNode->addr.addr))) {
@@ -135,13 +149,15 @@ int MP1Node::introduceSelfToGroup(Address *joinaddr) {
         memberNode->inGroup = true;
     }
     else {
-        size_t msgsize = sizeof(MessageHdr) + sizeof(joinaddr->addr) + sizeof(long) + 1;
-        msg = (MessageHdr *) malloc(msgsize * sizeof(char));
+        size_t msgsize = sizeof(MessageHdr) + 3 * WIRE_MAX_VARINT;
+        msg = (MessageHdr *) emulNet->getMsgPool()->alloc(msgsize * sizeof(char));
 
-        // create JOINREQ message: format of data is {struct Address myaddr}
+        // create JOINREQ message: format of data is {myaddr, heartbeat}
         msg->msgType = JOINREQ;
-        memcpy((char *)(msg+1), &memberNode->addr.addr, sizeof(memberNode->addr.addr));
-        memcpy((char *)(msg+1) + 1 + sizeof(memberNode->addr.addr), &memberNode->heartbeat, sizeof(long));
+        msg->version = WIRE_VERSION;
+        WireWriter out((char *)(msg+1), msgsize - sizeof(MessageHdr));
+        out.putAddress(&memberNode->addr);
+        out.putSVarint(memberNode->heartbeat);
 
 #ifdef DEBUGLOG
         sprintf(s, "Trying to join...");
@@ -149,13 +165,13 @@ int MP1Node::introduceSelfToGroup(Address *joinaddr) {
 #endif
 
         // send JOINREQ message to introducer member
-        if (0 == emulNet->ENsend(&memberNode->addr, joinaddr, (char *)msg, msgsize)) {
+        if (0 == emulNet->ENsend(&memberNode->addr, joinaddr, (char *)msg, sizeof(MessageHdr) + out.size())) {
 #ifdef DEBUGLOG
             log->LOG(&memberNode->addr, "IntroduceSelfToGroup ENsend failed");
 #endif
         }
 
-        free(msg);
+        emulNet->getMsgPool()->free((char *)msg, msgsize);
     }
 
     return 1;
@@ -168,11 +184,13 @@ int MP1Node::introduceSelfToGroup(Address *joinaddr) {
  * DESCRIPTION: Wind up this node and clean up state
  */
 int MP1Node::finishUpThisNode(){
-   /*
-    * Your code goes here
-    */
+    // Give back any messages that were received but never processed
+    while ( !memberNode->mp1q.empty() ) {
+        emulNet->ENrelease((char *)memberNode->mp1q.front().elt);
+        memberNode->mp1q.pop();
+    }
 
-   return 1;
+    return 1;
 }
 
 /**
@@ -186,6 +204,10 @@ void MP1Node::nodeLoop() {
     	return;
     }
 
+    // Catch up on the ticks the event-driven engine did not run this node for
+    skipIdleTicks(par->getcurrtime() - lastTick - 1);
+    lastTick = par->getcurrtime();
+
     // Check my messages
     checkMessages();
 
@@ -215,7 +237,10 @@ void MP1Node::checkMessages() {
     	size = memberNode->mp1q.front().size;
     	memberNode->mp1q.pop();
     	recvCallBack((void *)memberNode, (char *)ptr, size);
+    	// The buffer still belongs to the network; hand it back
+    	emulNet->ENrelease((char *)ptr);
     }
+    applyMergeBatch();
     return;
 }
 
@@ -235,6 +260,13 @@ bool MP1Node::recvCallBack(void *env, char *data, int size ) {
     }
 
     MessageHdr *msg = (MessageHdr *) data;
+    if (msg->version != WIRE_VERSION) {
+#ifdef DEBUGLOG
+        log->LOG(&memberNode->addr, "Unexpected message version %d", msg->version);
+#endif
+        return false;
+    }
+
     switch (msg->msgType)
     {
     case JOINREQ:
@@ -243,6 +275,10 @@ bool MP1Node::recvCallBack(void *env, char *data, int size ) {
         return handleJoinReplyMessage(data, size);
     case GOSSIP:
         return handleGossipMessage(data, size);
+    case PING:
+    case ACK:
+    case PINGREQ:
+        return handleSwimMessage(data, size);
     
     default:
         return false;
@@ -250,16 +286,21 @@ bool MP1Node::recvCallBack(void *env, char *data, int size ) {
 }
 
 bool MP1Node::handleJoinRequestMessage(char *data, int size) {
-    char addr[6];
-    long heartbeat = 0;
     MessageHdr *msg = (MessageHdr *)data;
+    // The reply carries what the lists received before this request said
+    applyMergeBatch();
 
-    memcpy(&addr, (char *) (msg+1), sizeof(addr));
-    memcpy(&heartbeat, (char *)(msg+1) + 1 + sizeof(addr), sizeof(long));
+    WireReader in((char *)(msg+1), size - sizeof(MessageHdr));
 
     Address toaddr;
-    *(int*)(toaddr.addr) = *(int*)addr;
-	*(short *)(&toaddr.addr[4]) = *(short*)(&addr[4]);
+    in.getAddress(&toaddr);
+    long heartbeat = in.getSVarint();
+    if (!in.ok()) {
+#ifdef DEBUGLOG
+        log->LOG(&memberNode->addr, "JOINREQ truncated, %d bytes", size);
+#endif
+        return false;
+    }
 #ifdef DEBUGLOG
     log->LOG(&memberNode->addr, "Sending JoinReply to %s", toaddr.getAddress().c_str());
 #endif
@@ -267,9 +308,14 @@ bool MP1Node::handleJoinRequestMessage(char *data, int size) {
     // Send the membership list as JOINREP message
     sendMembershipListTo(&toaddr, JOINREP);
 
-    int id = *(int *)(&addr[0]);
-    short port = *(short *)(&addr[4]);
-    addMember(id, port, heartbeat);
+    int id = *(int *)(&toaddr.addr[0]);
+    short port = *(short *)(&toaddr.addr[4]);
+    if (par->PROTOCOL == SWIM) {
+        // Everyone else learns about the new member from piggybacked updates
+        swimApply(id, port, heartbeat, SWIM_ALIVE, true);
+    } else {
+        addMember(id, port, heartbeat);
+    }
 
     return true;
 }
@@ -313,40 +359,50 @@ bool MP1Node::handleGossipMessage(char *data, int size)
  * 				Propagate your membership list
  */
 void MP1Node::nodeLoopOps() {
-    // Update local clock
-    memberNode->heartbeat++;
-    memberNode->myPos->heartbeat = memberNode->heartbeat;
-    memberNode->myPos->timestamp = memberNode->heartbeat;
-
-    for (auto member = memberNode->memberList.begin(); member != memberNode->memberList.end();) {
-        if (member->gettimestamp() + TFAIL + TREMOVE <= memberNode->heartbeat) {
-            Address addr;
-            *(int*)(addr.addr) = member->getid();
-            *(short *)(&addr.addr[4]) = member->getport();
-            log->logNodeRemove(&memberNode->addr, &addr);
-            member = memberNode->memberList.erase(member);
-            memberNode->nnb--;
-        } else {
-            ++member;
+    if (par->PROTOCOL == SWIM) {
+        swimLoopOps();
+        return;
+    }
+
+    advanceClock();
+
+    // Drop timed out members; most ticks no member can have, and the table is not read
+    if (memberNode->heartbeat >= sweepDue) {
+        expiredSlots.clear();
+        sweepDue = members.expired(memberNode->heartbeat, expiredSlots);
+        for (int slot : expiredSlots) {
+            forgetMember(slot);
         }
+        members.removeAll(expiredSlots);
     }
-    
-    // Update my position in the list in case list was modified
-    memberNode->myPos = memberNode->memberList.begin();
 
-    // Check if its time to send ping
+    pruneRemovedList();
+
+    // Check if its time to send ping; below zero once a daemon has overrun the round
     memberNode->pingCounter--;
-    if (memberNode->pingCounter == 0) {
-        for (auto member = memberNode->memberList.begin(); member != memberNode->memberList.end(); ++member) {
-            if (member == memberNode->myPos) continue;
+    if (memberNode->pingCounter <= 0) {
+        vector<Address> targets;
+        selectGossipTargets(targets, par->GOSSIP_FANOUT, par->GOSSIP_ROTATE);
 
-            Address toaddr;
-            *(int*)(toaddr.addr) = member->getid();
-            *(short *)(&toaddr.addr[4]) = member->getport();
-            sendMembershipListTo(&toaddr, GOSSIP);
+        // In delta mode every few rounds still carry the full list, to repair dropped deltas
+        gossipRound++;
+        bool full = !par->GOSSIP_DELTA || par->GOSSIP_FULL_EVERY <= 1 || gossipRound % par->GOSSIP_FULL_EVERY == 0;
+
+        // The full list is the same for every target, so it goes out as one multicast
+        if (full) {
+            multicastMembershipList(targets, GOSSIP);
+        }
+
+        for (Address &toaddr : targets) {
+            if (!full) {
+                sendMembershipListTo(&toaddr, GOSSIP, peerVersion[memberKey(*(int*)(toaddr.addr), *(short *)(&toaddr.addr[4]))]);
+            }
+            if (par->GOSSIP_DELTA) {
+                peerVersion[memberKey(*(int*)(toaddr.addr), *(short *)(&toaddr.addr[4]))] = tableVersion;
+            }
 
 #ifdef DEBUGLOG
-            log->LOG(&memberNode->addr, "GOSSIP to %d:%d", member->getid(), member->getport());           
+            log->LOG(&memberNode->addr, "GOSSIP to %s", toaddr.getAddress().c_str());
 #endif
         }
 
@@ -356,6 +412,131 @@ void MP1Node::nodeLoopOps() {
     return;
 }
 
+/**
+ * FUNCTION NAME: advanceClock
+ *
+ * DESCRIPTION: Update local clock and the own entry for one gossip tick
+ */
+void MP1Node::advanceClock() {
+    int self = selfSlot();
+    memberNode->heartbeat++;
+    members.heartbeats[self] = memberNode->heartbeat;
+    members.timestamps[self] = memberNode->heartbeat;
+    members.deadlines[self] = memberNode->heartbeat + TFAIL + TREMOVE;
+    fullPayloadStale = true;
+    if (heartbeatNews(memberNode->heartbeat - 1, memberNode->heartbeat)) {
+        members.versions[self] = ++tableVersion;
+    }
+}
+
+/**
+ * FUNCTION NAME: skipIdleTicks
+ *
+ * DESCRIPTION: Replay the bookkeeping of ticks this node was not run for.
+ * 				Under the event-driven engine nextTick guarantees no member timed out
+ * 				and no gossip was due during them, and no message arrived, so only the
+ * 				clock moves. A daemon that overran its tick gets no such guarantee:
+ * 				the counters may run past zero, and the round or probe period that
+ * 				fell due is run once by the tick that follows.
+ */
+void MP1Node::skipIdleTicks(long ticks) {
+    if (ticks <= 0 || !memberNode->inGroup) {
+        return;
+    }
+
+    // SWIM timeouts are kept on the local clock; the own entry carries the incarnation
+    if (par->PROTOCOL == SWIM) {
+        memberNode->heartbeat += ticks;
+        memberNode->pingCounter -= ticks;
+        return;
+    }
+
+    for (long i = 0; i < ticks; i++) {
+        advanceClock();
+        memberNode->pingCounter--;
+    }
+    pruneRemovedList();
+}
+
+/**
+ * FUNCTION NAME: nextTick
+ *
+ * DESCRIPTION: Global time at which this node next has work of its own: the next
+ * 				gossip round or member timeout. -1 if only a message can give it work.
+ */
+long MP1Node::nextTick() {
+    if (memberNode->bFailed || !memberNode->inGroup) {
+        return -1;
+    }
+    // SWIM timers are spread over probes, relays and suspects; run every tick
+    if (par->PROTOCOL == SWIM) {
+        return par->getcurrtime() + 1;
+    }
+
+    long due = min((long)memberNode->pingCounter, members.earliest() - memberNode->heartbeat);
+    return par->getcurrtime() + (due > 1 ? due : 1);
+}
+
+/**
+ * FUNCTION NAME: selectGossipTargets
+ *
+ * DESCRIPTION: Pick the peers to contact this round.
+ * 				With fanout 0 every member is a target; otherwise fanout peers are
+ * 				sampled at random, or taken in turn from a shuffled order when rotate
+ * 				is set so that every peer is covered once per pass.
+ */
+void MP1Node::selectGossipTargets(vector<Address> &targets, int fanout, bool rotate) {
+    vector<Address> peers;
+    for (int slot = 0; slot < members.size(); slot++) {
+        if (isSelf(members.ids[slot], members.ports[slot])) continue;
+
+        Address addr;
+        *(int*)(addr.addr) = members.ids[slot];
+        *(short *)(&addr.addr[4]) = members.ports[slot];
+        peers.push_back(addr);
+    }
+
+    if (fanout <= 0 || fanout >= (int)peers.size()) {
+        targets = peers;
+        return;
+    }
+
+    if (!rotate) {
+        // Partial Fisher-Yates: the first fanout slots end up a uniform sample
+        for (int i = 0; i < fanout; i++) {
+            int j = i + rand_r(&rngSeed) % (peers.size() - i);
+            swap(peers[i], peers[j]);
+            targets.push_back(peers[i]);
+        }
+        return;
+    }
+
+    while ((int)targets.size() < fanout) {
+        if (peerCursor >= peerOrder.size()) {
+            // Start a new pass over the current members
+            peerOrder = peers;
+            for (int i = (int)peerOrder.size() - 1; i > 0; i--) {
+                swap(peerOrder[i], peerOrder[rand_r(&rngSeed) % (i + 1)]);
+            }
+            peerCursor = 0;
+        }
+
+        Address &next = peerOrder[peerCursor++];
+
+        // Skip peers removed since the shuffle and ones already picked across a pass boundary
+        bool live = members.find(*(int*)(next.addr), *(short *)(&next.addr[4])) >= 0;
+        for (Address &picked : targets) {
+            if (picked == next) {
+                live = false;
+                break;
+            }
+        }
+        if (live) {
+            targets.push_back(next);
+        }
+    }
+}
+
 /**
  * FUNCTION NAME: isNullAddress
  *
@@ -386,7 +567,9 @@ Address MP1Node::getJoinAddress() {
  * DESCRIPTION: Initialize the membership list
  */
 void MP1Node::initMemberListTable(Member *memberNode) {
-	memberNode->memberList.clear();
+	members.clear();
+	sweepDue = 0;
+	fullPayloadStale = true;
 }
 
 /**
@@ -400,133 +583,1012 @@ void MP1Node::printAddress(Address *addr)
                                                        addr->addr[3], *(short*)&addr->addr[4]) ;    
 }
 
+/**
+ * FUNCTION NAME: isSelf
+ *
+ * DESCRIPTION: Whether id and port are this node's
+ */
+bool MP1Node::isSelf(int id, short port) {
+    return id == *(int*)(memberNode->addr.addr) && port == *(short *)(&memberNode->addr.addr[4]);
+}
+
+/**
+ * FUNCTION NAME: selfSlot
+ *
+ * DESCRIPTION: Slot of this node's own entry
+ */
+int MP1Node::selfSlot() {
+    return members.find(*(int*)(memberNode->addr.addr), *(short *)(&memberNode->addr.addr[4]));
+}
+
 void MP1Node::addMember(int id, short port, long heartbeat) {
+    // The first entry is this node's own
+    if (members.size() > 0 && !admitMember(id, port, heartbeat)) {
+        return;
+    }
+
+    // Check if member exist
+    int slot = members.find(id, port);
+    if (slot >= 0) {
+        updateMember(slot, heartbeat);
+        return;
+    }
+
+    MemberListEntry entry = newMember(id, port, heartbeat);
+    members.add(entry.id, entry.port, entry.heartbeat, entry.timestamp, entry.version, TFAIL + TREMOVE);
+}
+
+/**
+ * FUNCTION NAME: admitMember
+ *
+ * DESCRIPTION: Whether news of a member at heartbeat may enter the table at all
+ */
+bool MP1Node::admitMember(int id, short port, long heartbeat) {
     // Don't add the node itself again to the list
-    if (!memberNode->memberList.empty() && memberNode->myPos->getid() == id && memberNode->myPos->getport() == port) {
+    if (isSelf(id, port)) {
 #ifdef DEBUGLOG
         log->LOG(&memberNode->addr, "Trying to add node to itself...");
 #endif
-        return;
+        return false;
     }
 
-    // Discard old nodes
-    if (heartbeat + TFAIL + TREMOVE <= memberNode->heartbeat) {
+    // Discard old nodes; SWIM carries incarnations instead of heartbeats, which do not age
+    if (par->PROTOCOL != SWIM && heartbeat + TFAIL + TREMOVE <= memberNode->heartbeat) {
 #ifdef DEBUGLOG
         log->LOG(&memberNode->addr, "Trying to add a failed node %d:%d", id, port);
 #endif
-        return;
+        return false;
     }
 
-    // Check if member exist
-    for (auto member = memberNode->memberList.begin(); member != memberNode->memberList.end(); ++member) {
-        if (member->getid() == id && member->getport() == port) {
-            // Update the member heartbeat and the timestamp which indicate last update based on local clock
-            if (member->getheartbeat() < heartbeat) {
+    // Ignore gossip about a removed member unless it has heartbeated since
+    for (MemberListEntry &removed : removedList) {
+        if (removed.getid() == id && removed.getport() == port && heartbeat <= removed.getheartbeat()) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * FUNCTION NAME: updateMember
+ *
+ * DESCRIPTION: Move the member in slot to heartbeat if that is newer than what the table holds
+ */
+void MP1Node::updateMember(int slot, long heartbeat) {
+    // Update the member heartbeat and the timestamp which indicate last update based on local clock
+    if (members.heartbeats[slot] < heartbeat) {
 #ifdef DEBUGLOG
-                log->LOG(&memberNode->addr, "Update member %d:%d heartbeat %d -> %d ",
-                        member->getid(), member->getport(), member->getheartbeat(), heartbeat);
+        log->LOG(&memberNode->addr, "Update member %d:%d heartbeat %d -> %d ",
+                members.ids[slot], members.ports[slot], members.heartbeats[slot], heartbeat);
 #endif
-                member->heartbeat = heartbeat;
-                member->timestamp = memberNode->heartbeat;
-            }
+        if (heartbeatNews(members.heartbeats[slot], heartbeat)) {
+            members.versions[slot] = ++tableVersion;
+        }
+        // Later news in the same tick is the same arrival, not an interval of zero
+        int interval = memberNode->heartbeat - members.timestamps[slot];
+        if (par->FD_MODE == PHI_ACCRUAL && interval > 0) {
+            members.addArrival(slot, interval);
+        }
+        members.heartbeats[slot] = heartbeat;
+        members.timestamps[slot] = memberNode->heartbeat;
+        members.deadlines[slot] = memberNode->heartbeat + failureTimeout(slot);
+        sweepDue = min(sweepDue, (long)members.deadlines[slot]);
+        fullPayloadStale = true;
+    }
+}
 
-            return;
+/**
+ * FUNCTION NAME: failureTimeout
+ *
+ * DESCRIPTION: Ticks after its last heartbeat at which the member in slot is removed.
+ * 				Phi accrual takes the intervals between its heartbeats as normally
+ * 				distributed; phi = -log10 P(no heartbeat yet) grows with the time since
+ * 				the last one and reaches PHI_THRESHOLD phiDeviations standard deviations
+ * 				past the mean, so the deadline is known as soon as the heartbeat arrives.
+ */
+long MP1Node::failureTimeout(int slot) {
+    ArrivalWindow &w = members.arrivals[slot];
+    if (par->FD_MODE != PHI_ACCRUAL || w.count < FD_MIN_SAMPLES) {
+        return TFAIL + TREMOVE;
+    }
+
+    double mean = (double)w.sum / w.count;
+    double variance = max(0.0, (double)w.squares / w.count - mean * mean);
+    double deviation = max(sqrt(variance), FD_MIN_STDDEV);
+    return max(1L, (long)ceil(mean + phiDeviations * deviation));
+}
+
+/**
+ * FUNCTION NAME: phiQuantile
+ *
+ * DESCRIPTION: Standard deviations past the mean of a normal distribution at which phi
+ * 				reaches threshold, found by bisection
+ */
+double MP1Node::phiQuantile(double threshold) {
+    double low = 0;
+    double high = 40;
+    for (int i = 0; i < 60; i++) {
+        double mid = (low + high) / 2;
+        // Probability of a normal variable landing above mid
+        if (-log10(0.5 * erfc(mid / sqrt(2.0))) < threshold) {
+            low = mid;
+        } else {
+            high = mid;
         }
     }
+    return high;
+}
 
-    // Add new member
+/**
+ * FUNCTION NAME: newMember
+ *
+ * DESCRIPTION: Log the arrival of a member and return its entry, for the caller to insert
+ */
+MemberListEntry MP1Node::newMember(int id, short port, long heartbeat) {
     Address addr;
     *(int*)(addr.addr) = id;
     *(short *)(&addr.addr[4]) = port;
     log->logNodeAdd(&memberNode->addr, &addr);
 
     memberNode->nnb++;
-    memberNode->memberList.insert(memberNode->memberList.end(), MemberListEntry(id, port, heartbeat, memberNode->heartbeat));
+    MemberListEntry entry(id, port, heartbeat, memberNode->heartbeat);
+    entry.version = ++tableVersion;
+    sweepDue = min(sweepDue, memberNode->heartbeat + TFAIL + TREMOVE);
+    fullPayloadStale = true;
+    return entry;
+}
 
-    return;
+/**
+ * FUNCTION NAME: heartbeatNews
+ *
+ * DESCRIPTION: Whether a heartbeat moving from before to after is worth a new table version.
+ * 				Deltas only carry heartbeats once they cross a multiple of GOSSIP_DELTA_STEP,
+ * 				so peers are not sent entries that are barely newer than what they hold.
+ */
+bool MP1Node::heartbeatNews(long before, long after) {
+    int step = par->GOSSIP_DELTA_STEP > 1 ? par->GOSSIP_DELTA_STEP : 1;
+    return before / step != after / step;
 }
 
-void MP1Node::sendMembershipListTo(Address *toaddr, MsgTypes type) {
+/**
+ * FUNCTION NAME: memberKey
+ *
+ * DESCRIPTION: Pack a member address into a single key
+ */
+long long MP1Node::memberKey(int id, short port) {
+    return MemberTable::key(id, port);
+}
+
+/**
+ * FUNCTION NAME: sendMembershipListTo
+ *
+ * DESCRIPTION: Send the entries that changed after sinceVersion, the whole list by default.
+ * 				The whole list is encoded once per change of the table and the same bytes
+ * 				go to every peer until the next one.
+ */
+void MP1Node::sendMembershipListTo(Address *toaddr, MsgTypes type, long sinceVersion) {
     // Don't send to self
     if (toaddr->getAddress() == memberNode->addr.getAddress()) {
         log->LOG(&memberNode->addr, "Trying to send membership to self...");
         return;
     }
 
-    const int members_count = memberNode->memberList.size();
-    const int member_size = sizeof(short) + sizeof(int) + sizeof(long);
-    const size_t msgsize = 1 + sizeof(MessageHdr) + sizeof(int) + members_count * (member_size);
-
-    char *msg = (char *) malloc(msgsize * sizeof(char));
+    vector<char> *msg = &fullPayload;
+    vector<int> *chunks = &fullChunks;
+    if (sinceVersion > 0) {
+        encodeMembershipList(deltaPayload, deltaChunks, sinceVersion);
+        msg = &deltaPayload;
+        chunks = &deltaChunks;
+    } else {
+        refreshFullPayload();
+    }
 
-    MessageHdr *hdr = (MessageHdr *)msg;
-    hdr->msgType = type;
+    for (size_t c = 0; c + 1 < chunks->size(); c++) {
+        char *chunk = msg->data() + (*chunks)[c];
+        // Only the type differs between a JOINREP and a GOSSIP of the same list
+        ((MessageHdr *)chunk)->msgType = type;
 
-    memcpy((char *)(hdr+1), &members_count, sizeof(int));
-    char *data = ((char*)(hdr+1) + sizeof(int));
+        if (emulNet->ENsend(&memberNode->addr, toaddr, chunk, (*chunks)[c + 1] - (*chunks)[c]) == 0) {
+#ifdef DEBUGLOG
+            log->LOG(&memberNode->addr, "SendMembership ENsend failed");
+#endif
+        }
+    }
+}
 
-    for (MemberListEntry& entry : memberNode->memberList) {
-        memcpy(data, &entry.id, sizeof(int));
-        memcpy(data + sizeof(int), &entry.port, sizeof(short));
-        memcpy(data + sizeof(int) + sizeof(short), &entry.heartbeat, sizeof(long));
-        data += sizeof(short) + sizeof(int) + sizeof(long);
+/**
+ * FUNCTION NAME: multicastMembershipList
+ *
+ * DESCRIPTION: Send the whole list to every address of targets, none of which may be
+ * 				this node. The network keeps a single copy of the bytes for all of them.
+ */
+void MP1Node::multicastMembershipList(vector<Address> &targets, MsgTypes type) {
+    if (targets.empty()) {
+        return;
     }
 
-    if (emulNet->ENsend(&memberNode->addr, toaddr, msg, msgsize) == 0) {
+    refreshFullPayload();
+
+    for (size_t c = 0; c + 1 < fullChunks.size(); c++) {
+        char *chunk = fullPayload.data() + fullChunks[c];
+        ((MessageHdr *)chunk)->msgType = type;
+
+        int sent = emulNet->ENmulticast(&memberNode->addr, targets, chunk, fullChunks[c + 1] - fullChunks[c]);
+        if (sent < (int)targets.size()) {
 #ifdef DEBUGLOG
-        log->LOG(&memberNode->addr, "SendMembership ENsend failed");
+            log->LOG(&memberNode->addr, "SendMembership ENmulticast reached %d of %d", sent, (int)targets.size());
 #endif
+        }
+    }
+}
+
+/**
+ * FUNCTION NAME: refreshFullPayload
+ *
+ * DESCRIPTION: Encode the whole list again if the table changed since it was last encoded
+ */
+void MP1Node::refreshFullPayload() {
+    if (fullPayloadStale) {
+        encodeMembershipList(fullPayload, fullChunks, 0);
+        fullPayloadStale = false;
+    }
+}
+
+/**
+ * FUNCTION NAME: encodeMembershipList
+ *
+ * DESCRIPTION: Encode the entries that changed after sinceVersion into msg as a series of
+ * 				chunks, each a complete message no larger than the network carries.
+ * 				chunks receives the offset of each chunk in msg followed by msg's size.
+ * 				A chunk can be applied without the others, so a lost one only costs its entries.
+ * 				Each chunk takes whichever of the ListLayouts is shorter for its entries:
+ * 				node ids are dense, so a whole list is a bitmap of one bit per member,
+ * 				while a delta with scattered ids is shorter as a list of entries.
+ */
+void MP1Node::encodeMembershipList(vector<char> &msg, vector<int> &chunks, long sinceVersion) {
+    // Heartbeats go out as offsets from the smallest one in the chunk, never above
+    // their offset from the smallest one sent, which is what the split is sized with
+    encodeSlots.clear();
+    long lowest = 0;
+    for (int slot = 0; slot < members.size(); slot++) {
+        if (members.versions[slot] > sinceVersion) {
+            if (encodeSlots.empty() || members.heartbeats[slot] < lowest) {
+                lowest = members.heartbeats[slot];
+            }
+            encodeSlots.push_back(slot);
+        }
     }
 
-    free(msg);    
+    // Room for a chunk header whatever its numbers, base and layout turn out to be
+    int limit = emulNet->ENmaxSize();
+    int header = sizeof(MessageHdr) + 4 * WIRE_MAX_VARINT + 1;
+    vector<int> &splits = encodeSplits;
+    splits.clear();
+    splits.push_back(0);
+    // Bytes of the chunk so far: heartbeats, which both layouts carry, and ids and ports as entries
+    long long heartbeatBytes = 0;
+    long long entryBytes = 0;
+    bool onePort = true;
+    int firstSlot = encodeSlots.empty() ? 0 : encodeSlots[0];
+    int previd = 0;
+    for (size_t k = 0; k < encodeSlots.size(); k++) {
+        int slot = encodeSlots[k];
+        int id = members.ids[slot];
+        int heartbeat = WireWriter::varintSize(members.heartbeats[slot] - lowest);
+        int entry = WireWriter::svarintSize(id - previd) + WireWriter::svarintSize(members.ports[slot]);
+        bool samePort = onePort && members.ports[slot] == members.ports[firstSlot];
+        long long ids = samePort ? min(entryBytes + entry, bitmapSize(members.ids[firstSlot], id, members.ports[slot])) : entryBytes + entry;
+        if (header + heartbeatBytes + heartbeat + ids > limit && k > (size_t)splits.back()) {
+            splits.push_back(k);
+            heartbeatBytes = 0;
+            entryBytes = 0;
+            samePort = true;
+            firstSlot = slot;
+            entry = WireWriter::svarintSize(id) + WireWriter::svarintSize(members.ports[slot]);
+        }
+        heartbeatBytes += heartbeat;
+        entryBytes += entry;
+        onePort = samePort;
+        previd = id;
+    }
+    splits.push_back(encodeSlots.size());
+
+    // Keeps its capacity, so encoding a list no longer than the last one does not allocate
+    msg.clear();
+    chunks.clear();
+    int count = splits.size() - 1;
+    for (int c = 0; c < count; c++) {
+        int first = splits[c];
+        int last = splits[c + 1];
+        int members_count = last - first;
+        int firstId = members.ids[encodeSlots[first]];
+        int lastId = members.ids[encodeSlots[last - 1]];
+        short port = members.ports[encodeSlots[first]];
+        long base = 0;
+        bool bitmap = true;
+        for (int k = first; k < last; k++) {
+            if (k == first || members.heartbeats[encodeSlots[k]] < base) {
+                base = members.heartbeats[encodeSlots[k]];
+            }
+            bitmap = bitmap && members.ports[encodeSlots[k]] == port;
+        }
+
+        size_t msgsize = sizeof(MessageHdr) + WireWriter::varintSize(c) + WireWriter::varintSize(count)
+                + WireWriter::varintSize(members_count) + WireWriter::svarintSize(base) + 1;
+        size_t entries = 0;
+        previd = 0;
+        for (int k = first; k < last; k++) {
+            int slot = encodeSlots[k];
+            msgsize += WireWriter::varintSize(members.heartbeats[slot] - base);
+            entries += WireWriter::svarintSize(members.ids[slot] - previd) + WireWriter::svarintSize(members.ports[slot]);
+            previd = members.ids[slot];
+        }
+        bitmap = bitmap && bitmapSize(firstId, lastId, port) < (long long)entries;
+        msgsize += bitmap ? bitmapSize(firstId, lastId, port) : entries;
+
+        size_t offset = msg.size();
+        chunks.push_back(offset);
+        msg.resize(offset + msgsize);
+
+        MessageHdr *hdr = (MessageHdr *)(msg.data() + offset);
+        hdr->version = WIRE_VERSION;
+
+        // Format is {chunk, chunks, count, base, layout, entries}, the entries as
+        // LIST_ENTRIES: count x {id - previous id, port, heartbeat - base}
+        // LIST_BITMAP: {first id, port, bitmap bytes, bitmap, count x {heartbeat - base}}
+        WireWriter out((char *)(hdr+1), msgsize - sizeof(MessageHdr));
+        out.putVarint(c);
+        out.putVarint(count);
+        out.putVarint(members_count);
+        out.putSVarint(base);
+        out.putByte(bitmap ? LIST_BITMAP : LIST_ENTRIES);
+
+        if (bitmap) {
+            // Bit b of byte i stands for the id 8 * i + b past the first
+            encodeBitmap.assign(((long long)lastId - firstId) / 8 + 1, 0);
+            for (int k = first; k < last; k++) {
+                long long bit = (long long)members.ids[encodeSlots[k]] - firstId;
+                encodeBitmap[bit / 8] |= 1 << (bit % 8);
+            }
+            out.putSVarint(firstId);
+            out.putSVarint(port);
+            out.putVarint(encodeBitmap.size());
+            for (unsigned char bits : encodeBitmap) {
+                out.putByte(bits);
+            }
+            for (int k = first; k < last; k++) {
+                out.putVarint(members.heartbeats[encodeSlots[k]] - base);
+            }
+            continue;
+        }
+
+        previd = 0;
+        for (int k = first; k < last; k++) {
+            int slot = encodeSlots[k];
+            out.putSVarint(members.ids[slot] - previd);
+            out.putSVarint(members.ports[slot]);
+            out.putVarint(members.heartbeats[slot] - base);
+            previd = members.ids[slot];
+        }
+    }
+    chunks.push_back(msg.size());
+}
+
+/**
+ * FUNCTION NAME: bitmapSize
+ *
+ * DESCRIPTION: Bytes the ids and port of a LIST_BITMAP chunk from firstId to lastId take
+ */
+long long MP1Node::bitmapSize(int firstId, int lastId, short port) {
+    long long bytes = ((long long)lastId - firstId) / 8 + 1;
+    return WireWriter::svarintSize(firstId) + WireWriter::svarintSize(port) + WireWriter::varintSize(bytes) + bytes;
 }
 
 bool MP1Node::receiveMembershipList(char *data, int size)
 {
-    int expected_size = sizeof(int);
-    if (size < expected_size) {
+    WireReader in(data, size);
+    unsigned long long chunk = in.getVarint();
+    unsigned long long chunks = in.getVarint();
+    unsigned long long members_count = in.getVarint();
+    long base = in.getSVarint();
+    unsigned char layout = in.getByte();
+
+    // Every entry takes at least the byte of its heartbeat
+    if (!in.ok() || chunk >= chunks || members_count > (unsigned long long)in.remaining()
+            || (layout != LIST_ENTRIES && layout != LIST_BITMAP)) {
 #ifdef DEBUGLOG
-        log->LOG(&memberNode->addr, "ReceiveMembership expected message size %d got %d", expected_size, size);
+        log->LOG(&memberNode->addr, "ReceiveMembership malformed list of %d bytes", size);
 #endif
         return false;
     }
 
-    int members_count;
-    memcpy(&members_count, data, sizeof(int));
-    
-    expected_size += members_count * (sizeof(int) + sizeof(short) + sizeof(long));
-    if (size < expected_size) {
 #ifdef DEBUGLOG
-        log->LOG(&memberNode->addr, "ReceiveMembership expected message size %d got %d", expected_size, size);
+    log->LOG(&memberNode->addr, "Received member list %d, chunk %d of %d", (int)members_count, (int)chunk + 1, (int)chunks);
 #endif
+
+    // The list is read whole before any of it is applied
+    recvIds.clear();
+    recvPorts.clear();
+    recvHeartbeats.clear();
+    if (layout == LIST_BITMAP) {
+        long long first = in.getSVarint();
+        short port = (short)in.getSVarint();
+        unsigned long long bytes = in.getVarint();
+        if (bytes > (unsigned long long)in.remaining()) {
+            return false;
+        }
+        for (unsigned long long i = 0; i < bytes; i++) {
+            unsigned int bits = in.getByte();
+            while (bits) {
+                recvIds.push_back((int)(first + 8 * (long long)i + __builtin_ctz(bits)));
+                recvPorts.push_back(port);
+                bits &= bits - 1;
+            }
+        }
+        if (recvIds.size() != members_count) {
+            return false;
+        }
+        for (unsigned long long i = 0; i < members_count; i++) {
+            recvHeartbeats.push_back(base + (long)in.getVarint());
+        }
+    } else {
+        int id = 0;
+        for (unsigned long long i = 0; i < members_count; i++) {
+            id += (int)in.getSVarint();
+            recvIds.push_back(id);
+            recvPorts.push_back((short)in.getSVarint());
+            recvHeartbeats.push_back(base + (long)in.getVarint());
+        }
+    }
+    if (!in.ok()) {
         return false;
     }
-    
+    int n = recvIds.size();
+    // A list sent whole, not as a delta or in chunks, is the sender's count of the group
+    bool whole = !par->GOSSIP_DELTA && chunks == 1;
+
+    mergeUpdated.clear();
+    mergeAdded.clear();
+    if (par->PROTOCOL == SWIM || !members.merge(recvIds.data(), recvPorts.data(), recvHeartbeats.data(), n,
+            memberNode->heartbeat - TFAIL - TREMOVE, mergeUpdated, mergeAdded)) {
+        // Entry by entry: SWIM merges states, and a list out of key order cannot be walked
+        for (int i = 0; i < n; i++) {
+            // Avoid adding ourselves
+            if (isSelf(recvIds[i], recvPorts[i])) {
+                continue;
+            }
+            if (par->PROTOCOL == SWIM) {
+                swimApply(recvIds[i], recvPorts[i], recvHeartbeats[i], SWIM_ALIVE, false);
+            } else if (par->GOSSIP_BATCH) {
+                batchMember(recvIds[i], recvPorts[i], recvHeartbeats[i]);
+            } else {
+                addMember(recvIds[i], recvPorts[i], recvHeartbeats[i]);
+            }
+        }
+        if (whole) {
+            memberNode->nnb = members_count;
+        }
+        return true;
+    }
+
+    // Members the table holds already passed admission with an older heartbeat
+    for (pair<int, int> &update : mergeUpdated) {
+        if (isSelf(recvIds[update.second], recvPorts[update.second])) {
+            continue;
+        }
+        if (par->GOSSIP_BATCH) {
+            batchSlot(update.first, recvHeartbeats[update.second]);
+        } else {
+            updateMember(update.first, recvHeartbeats[update.second]);
+        }
+    }
+
+    for (int i : mergeAdded) {
+        if (par->GOSSIP_BATCH) {
+            batchMember(recvIds[i], recvPorts[i], recvHeartbeats[i]);
+        } else if (admitMember(recvIds[i], recvPorts[i], recvHeartbeats[i])) {
+            mergeInserts.push_back(newMember(recvIds[i], recvPorts[i], recvHeartbeats[i]));
+        }
+    }
+    members.insertAll(mergeInserts, TFAIL + TREMOVE);
+    mergeInserts.clear();
+
+    if (whole) {
+        memberNode->nnb = members_count;
+    }
+    return true;
+}
+
+/**
+ * FUNCTION NAME: batchMember
+ *
+ * DESCRIPTION: Keep the highest heartbeat received for a member this tick.
+ * 				addMember only ever moves a member to a higher heartbeat, so applying the
+ * 				highest once leaves it as applying every one in turn would. Entries no newer
+ * 				than the table are dropped here, and members already in it cost one lookup.
+ */
+void MP1Node::batchMember(int id, short port, long heartbeat) {
+    int slot = members.find(id, port);
+    if (slot < 0) {
+        auto found = mergeIndex.find(memberKey(id, port));
+        if (found == mergeIndex.end()) {
+            mergeIndex[memberKey(id, port)] = mergeBatch.size();
+            mergeBatch.push_back(MemberListEntry(id, port, heartbeat, 0));
+        } else if (mergeBatch[found->second].heartbeat < heartbeat) {
+            mergeBatch[found->second].heartbeat = heartbeat;
+        }
+        return;
+    }
+
+    if (heartbeat > members.heartbeats[slot]) {
+        batchSlot(slot, heartbeat);
+    }
+}
+
+/**
+ * FUNCTION NAME: batchSlot
+ *
+ * DESCRIPTION: Keep the highest heartbeat received this tick for the member in slot
+ */
+void MP1Node::batchSlot(int slot, long heartbeat) {
+    if ((int)mergeHeartbeats.size() <= slot) {
+        mergeHeartbeats.resize(members.size(), LONG_MIN);
+    }
+    long &pending = mergeHeartbeats[slot];
+    if (pending == LONG_MIN) {
+        mergeSlots.push_back(slot);
+    }
+    pending = max(pending, heartbeat);
+}
+
+/**
+ * FUNCTION NAME: applyMergeBatch
+ *
+ * DESCRIPTION: Merge the entries batched since the last call into the table. Slots
+ * 				stay valid in between, as the table does not change while a batch is open.
+ */
+void MP1Node::applyMergeBatch() {
+    for (int slot : mergeSlots) {
+        addMember(members.ids[slot], members.ports[slot], mergeHeartbeats[slot]);
+        mergeHeartbeats[slot] = LONG_MIN;
+    }
+    mergeSlots.clear();
+
+    if (!mergeBatch.empty()) {
+        for (MemberListEntry &entry : mergeBatch) {
+            if (admitMember(entry.id, entry.port, entry.heartbeat)) {
+                mergeInserts.push_back(newMember(entry.id, entry.port, entry.heartbeat));
+            }
+        }
+        members.insertAll(mergeInserts, TFAIL + TREMOVE);
+        mergeInserts.clear();
+        mergeBatch.clear();
+        mergeIndex.clear();
+    }
+}
+
+/**
+ * FUNCTION NAME: forgetMember
+ *
+ * DESCRIPTION: Log the removal of the member in slot and drop every reference to it.
+ * 				The caller takes the entry out of the table.
+ */
+void MP1Node::forgetMember(int slot) {
+    int id = members.ids[slot];
+    short port = members.ports[slot];
+    long long key = memberKey(id, port);
+
+    Address addr;
+    *(int*)(addr.addr) = id;
+    *(short *)(&addr.addr[4]) = port;
+    log->logNodeRemove(&memberNode->addr, &addr);
+
+    removedList.push_back(MemberListEntry(id, port, members.heartbeats[slot], memberNode->heartbeat));
+    removals.push_back(make_pair(id, par->getcurrtime()));
+    peerVersion.erase(key);
+    suspected.erase(key);
+    memberNode->nnb--;
+    fullPayloadStale = true;
+}
+
+/**
+ * FUNCTION NAME: removeMember
+ *
+ * DESCRIPTION: Remove a single member from the table
+ */
+void MP1Node::removeMember(long long key) {
+    int slot = members.find(key);
+    if (slot < 0) {
+        return;
+    }
+
+    forgetMember(slot);
+    members.remove(slot);
+}
+
+/**
+ * FUNCTION NAME: pruneRemovedList
+ *
+ * DESCRIPTION: Forget removed members once stale news about them can no longer arrive
+ */
+void MP1Node::pruneRemovedList() {
+    // By then every other member has timed out the same entries
+    long ttl = TFAIL + TREMOVE;
+    if (par->PROTOCOL == SWIM) {
+        // Old updates may still be piggybacked for a whole retransmission cycle
+        ttl = (long)swimRetransmitLimit() * par->SWIM_PERIOD + par->SWIM_SUSPECT;
+    }
+
+    for (auto removed = removedList.begin(); removed != removedList.end();) {
+        if (removed->gettimestamp() + ttl <= memberNode->heartbeat) {
+            removed = removedList.erase(removed);
+        } else {
+            ++removed;
+        }
+    }
+}
+
+/**
+ * FUNCTION NAME: swimLoopOps
+ *
+ * DESCRIPTION: SWIM protocol period. Probe one member per period with a direct ping,
+ * 				fall back to ping-req through SWIM_HELPERS other members, suspect it if
+ * 				neither answers and remove suspects that did not refute in SWIM_SUSPECT ticks.
+ */
+void MP1Node::swimLoopOps() {
+    // Local clock for timeouts; the own entry carries the incarnation instead
+    memberNode->heartbeat++;
+    long now = memberNode->heartbeat;
+
+    // Suspects that did not refute in time are declared dead
+    vector<long long> expired;
+    for (auto &suspect : suspected) {
+        if (suspect.second + par->SWIM_SUSPECT <= now) {
+            expired.push_back(suspect.first);
+        }
+    }
+    for (long long key : expired) {
+        int slot = members.find(key);
+        if (slot >= 0) {
+            swimDisseminate(members.ids[slot], members.ports[slot], members.heartbeats[slot], SWIM_DEAD);
+        }
+        removeMember(key);
+    }
+
+    // No direct ack in time, ask helpers to probe the target for us
+    if (probeActive && !probeAcked && !probeIndirect && now - probeStart >= SWIM_ACK_TIMEOUT) {
+        vector<Address> peers;
+        selectGossipTargets(peers, 0, false);
+        for (auto peer = peers.begin(); peer != peers.end(); ++peer) {
+            if (*peer == probeTarget) {
+                peers.erase(peer);
+                break;
+            }
+        }
+
+        for (int i = 0; i < par->SWIM_HELPERS && i < (int)peers.size(); i++) {
+            int j = i + rand_r(&rngSeed) % (peers.size() - i);
+            swap(peers[i], peers[j]);
+            sendSwimMessage(&peers[i], PINGREQ, probeSeq, &probeTarget);
+        }
+        probeIndirect = true;
+    }
+
+    // Indirect probes run for others give up after a period
+    for (auto relay = relays.begin(); relay != relays.end();) {
+        if (relay->expires <= now) {
+            relay = relays.erase(relay);
+        } else {
+            ++relay;
+        }
+    }
+
+    pruneRemovedList();
+
+    memberNode->pingCounter--;
+    if (memberNode->pingCounter <= 0) {
+        if (probeActive && !probeAcked) {
+            swimSuspect(&probeTarget);
+        }
+        probeActive = false;
+
+        vector<Address> targets;
+        selectGossipTargets(targets, 1, true);
+        if (!targets.empty()) {
+            probeTarget = targets[0];
+            probeSeq++;
+            probeStart = now;
+            probeActive = true;
+            probeAcked = false;
+            probeIndirect = false;
+            sendSwimMessage(&probeTarget, PING, probeSeq, &memberNode->addr);
+        }
+
+        memberNode->pingCounter = par->SWIM_PERIOD;
+    }
+}
+
+/**
+ * FUNCTION NAME: handleSwimMessage
+ *
+ * DESCRIPTION: Apply the updates piggybacked on a PING, ACK or PINGREQ, then answer it
+ */
+bool MP1Node::handleSwimMessage(char *data, int size) {
+    MessageHdr *hdr = (MessageHdr *) data;
+    WireReader in((char *)(hdr+1), size - sizeof(MessageHdr));
+
+    Address from, subject;
+    in.getAddress(&from);
+    int seq = (int)in.getVarint();
+    in.getAddress(&subject);
+    unsigned long long count = in.getVarint();
+
+    // Every update takes at least four bytes
+    if (!in.ok() || count > (unsigned long long)in.remaining() / 4) {
 #ifdef DEBUGLOG
-    log->LOG(&memberNode->addr, "Received member list %d", members_count);
+        log->LOG(&memberNode->addr, "HandleSwim malformed message of %d bytes", size);
 #endif
+        return false;
+    }
 
-    char *msg = data + sizeof(int);
-    for (int i = 0; i < members_count; i++) {
-        int id;
-        short port;
-        long heartbeat;
+    for (unsigned long long i = 0; i < count; i++) {
+        int id = (int)in.getSVarint();
+        short port = (short)in.getSVarint();
+        long inc = (long)in.getVarint();
+        int state = in.getByte();
+        if (!in.ok()) {
+            return false;
+        }
 
-        memcpy(&id, msg, sizeof(int));
-        memcpy(&port, msg + sizeof(int), sizeof(short));
-        memcpy(&heartbeat, msg + sizeof(int) + sizeof(short), sizeof(long));
-        msg += sizeof(short) + sizeof(int) + sizeof(long);
+        swimApply(id, port, inc, state, true);
+    }
 
-        // Avoid adding ourselves
-        if (!(id == memberNode->myPos->getid() && port == memberNode->myPos->getport())) {
-            addMember(id, port, heartbeat);
+    switch (hdr->msgType) {
+    case PING:
+        sendSwimMessage(&from, ACK, seq, &memberNode->addr);
+        break;
+    case PINGREQ: {
+        // Probe subject on behalf of the sender and pass its ack back
+        SwimRelay relay;
+        relay.origin = from;
+        relay.target = subject;
+        relay.seq = seq;
+        relay.expires = memberNode->heartbeat + par->SWIM_PERIOD;
+        relays.push_back(relay);
+        sendSwimMessage(&subject, PING, seq, &from);
+        break;
+    }
+    case ACK:
+        if (probeActive && seq == probeSeq && subject == probeTarget) {
+            probeAcked = true;
+        }
+        for (auto relay = relays.begin(); relay != relays.end();) {
+            if (relay->seq == seq && relay->target == subject) {
+                sendSwimMessage(&relay->origin, ACK, seq, &subject);
+                relay = relays.erase(relay);
+            } else {
+                ++relay;
+            }
         }
+        break;
+    default:
+        return false;
     }
 
-    memberNode->nnb = members_count;
     return true;
 }
 
+/**
+ * FUNCTION NAME: sendSwimMessage
+ *
+ * DESCRIPTION: Send a PING, ACK or PINGREQ carrying the least sent pending updates.
+ * 				Format is {from, seq, subject, count, count x {id, port, incarnation, state}}
+ */
+void MP1Node::sendSwimMessage(Address *toaddr, MsgTypes type, int seq, Address *subject) {
+    // Piggyback the updates sent the fewest times so far
+    vector<size_t> order(updates.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+        return updates[a].sent < updates[b].sent;
+    });
+    int wanted = min((int)order.size(), SWIM_PIGGYBACK_MAX);
+
+    // Only as many as fit the largest message the network takes; the rest wait for the next one
+    int room = emulNet->ENmaxSize() - (int)sizeof(MessageHdr) - WireWriter::addressSize(&memberNode->addr)
+            - WireWriter::varintSize(seq) - WireWriter::addressSize(subject) - WireWriter::varintSize(wanted);
+    int count = 0;
+    while (count < wanted) {
+        SwimUpdate &update = updates[order[count]];
+        int bytes = WireWriter::svarintSize(update.id) + WireWriter::svarintSize(update.port) + WireWriter::varintSize(update.incarnation) + 1;
+        if (bytes > room) {
+            break;
+        }
+        room -= bytes;
+        count++;
+    }
+
+    const size_t msgsize = sizeof(MessageHdr) + (6 + 4 * count) * WIRE_MAX_VARINT;
+    char *msg = emulNet->getMsgPool()->alloc(msgsize);
+
+    MessageHdr *hdr = (MessageHdr *)msg;
+    hdr->msgType = type;
+    hdr->version = WIRE_VERSION;
+
+    WireWriter out((char *)(hdr+1), msgsize - sizeof(MessageHdr));
+    out.putAddress(&memberNode->addr);
+    out.putVarint(seq);
+    out.putAddress(subject);
+    out.putVarint(count);
+
+    for (int i = 0; i < count; i++) {
+        SwimUpdate &update = updates[order[i]];
+        out.putSVarint(update.id);
+        out.putSVarint(update.port);
+        out.putVarint(update.incarnation);
+        out.putByte((unsigned char)update.state);
+        update.sent++;
+    }
+
+    if (emulNet->ENsend(&memberNode->addr, toaddr, msg, sizeof(MessageHdr) + out.size()) == 0) {
+#ifdef DEBUGLOG
+        log->LOG(&memberNode->addr, "SendSwim ENsend failed");
+#endif
+    }
+    emulNet->getMsgPool()->free(msg, msgsize);
+
+    // Updates sent often enough have reached everyone with high probability
+    int limit = swimRetransmitLimit();
+    for (auto update = updates.begin(); update != updates.end();) {
+        if (update->sent >= limit) {
+            update = updates.erase(update);
+        } else {
+            ++update;
+        }
+    }
+}
+
+/**
+ * FUNCTION NAME: swimApply
+ *
+ * DESCRIPTION: Merge one SWIM update into the membership table.
+ * 				A higher incarnation overrides, suspicion overrides alive at the same
+ * 				incarnation and dead is final. Changes are passed on when disseminate is set.
+ */
+void MP1Node::swimApply(int id, short port, long inc, int state, bool disseminate) {
+    long long key = memberKey(id, port);
+
+    // News about this node: refute suspicion by moving to a newer incarnation
+    if (isSelf(id, port)) {
+        if (state != SWIM_ALIVE && inc >= incarnation) {
+            int self = selfSlot();
+            incarnation = inc + 1;
+            members.heartbeats[self] = incarnation;
+            members.versions[self] = ++tableVersion;
+            fullPayloadStale = true;
+            swimDisseminate(id, port, incarnation, SWIM_ALIVE);
+#ifdef DEBUGLOG
+            log->LOG(&memberNode->addr, "Refuting suspicion with incarnation %ld", incarnation);
+#endif
+        }
+        return;
+    }
+
+    // Members already declared dead stay dead
+    for (MemberListEntry &removed : removedList) {
+        if (removed.getid() == id && removed.getport() == port && inc <= removed.getheartbeat()) {
+            return;
+        }
+    }
+
+    int slot = members.find(key);
+    if (slot < 0) {
+        if (state == SWIM_DEAD) {
+            removedList.push_back(MemberListEntry(id, port, inc, memberNode->heartbeat));
+        } else {
+            addMember(id, port, inc);
+            if (state == SWIM_SUSPECT) {
+                suspected[key] = memberNode->heartbeat;
+            }
+        }
+        if (disseminate) {
+            swimDisseminate(id, port, inc, state);
+        }
+        return;
+    }
+
+    long known = members.heartbeats[slot];
+    switch (state) {
+    case SWIM_ALIVE:
+        if (inc <= known) {
+            return;
+        }
+        addMember(id, port, inc);
+        suspected.erase(key);
+        break;
+    case SWIM_SUSPECT:
+        if (inc < known || (inc == known && suspected.count(key))) {
+            return;
+        }
+        addMember(id, port, inc);
+        if (!suspected.count(key)) {
+            suspected[key] = memberNode->heartbeat;
+        }
+        break;
+    case SWIM_DEAD:
+        members.heartbeats[slot] = max(known, inc);
+        removeMember(key);
+        break;
+    default:
+        return;
+    }
+
+    if (disseminate) {
+        swimDisseminate(id, port, inc, state);
+    }
+}
+
+/**
+ * FUNCTION NAME: swimSuspect
+ *
+ * DESCRIPTION: Start suspecting a member that did not answer its probe
+ */
+void MP1Node::swimSuspect(Address *addr) {
+    int id = *(int*)(addr->addr);
+    short port = *(short *)(&addr->addr[4]);
+    long long key = memberKey(id, port);
+
+    int slot = members.find(key);
+    if (slot < 0 || suspected.count(key)) {
+        return;
+    }
+
+#ifdef DEBUGLOG
+    log->LOG(&memberNode->addr, "Suspecting %s", addr->getAddress().c_str());
+#endif
+    suspected[key] = memberNode->heartbeat;
+    swimDisseminate(id, port, members.heartbeats[slot], SWIM_SUSPECT);
+}
+
+/**
+ * FUNCTION NAME: swimDisseminate
+ *
+ * DESCRIPTION: Queue an update for piggybacking, replacing older news about the same member
+ */
+void MP1Node::swimDisseminate(int id, short port, long inc, int state) {
+    for (SwimUpdate &update : updates) {
+        if (update.id == id && update.port == port) {
+            update.incarnation = inc;
+            update.state = state;
+            update.sent = 0;
+            return;
+        }
+    }
+
+    SwimUpdate update;
+    update.id = id;
+    update.port = port;
+    update.incarnation = inc;
+    update.state = state;
+    update.sent = 0;
+    updates.push_back(update);
+}
+
+/**
+ * FUNCTION NAME: swimRetransmitLimit
+ *
+ * DESCRIPTION: Messages an update is piggybacked on, SWIM_RETRANSMIT_MULT * log2(group size)
+ */
+int MP1Node::swimRetransmitLimit() {
+    int lg = 1;
+    while ((1 << lg) < members.size() + 1) {
+        lg++;
+    }
+    return SWIM_RETRANSMIT_MULT * lg;
+}
+
 string MP1Node::debugMessage(char *msg, int size) {
     string message = "Message=";
     for (int i = 0; i < size; i++) {
@@ -14,12 +14,24 @@
 #include "Member.h"
 #include "EmulNet.h"
 #include "Queue.h"
+#include "Wire.h"
+#include "MemberTable.h"
 
 /**
  * Macros
  */
 #define TREMOVE 20
 #define TFAIL 5
+// ticks a SWIM probe waits for a direct ack before asking helpers
+#define SWIM_ACK_TIMEOUT 2
+// most SWIM updates piggybacked on one message, and how often each is sent per log2 of the group size
+#define SWIM_PIGGYBACK_MAX 16
+#define SWIM_RETRANSMIT_MULT 3
+// intervals a phi accrual member needs before its own distribution replaces TFAIL + TREMOVE,
+// and the least standard deviation assumed of them, in ticks, so a steady sender is not
+// removed the first time a heartbeat comes a tick late
+#define FD_MIN_SAMPLES 4
+#define FD_MIN_STDDEV 1.0
 
 /*
  * Note: You can change/add any functions in MP1Node.{h,cpp}
@@ -32,16 +44,82 @@ enum MsgTypes{
     JOINREQ,
     JOINREP,
 	GOSSIP,
+    PING,
+    ACK,
+    PINGREQ,
     DUMMYLASTMSGTYPE
 };
 
+/**
+ * Layouts of the entries of a membership list chunk
+ */
+enum ListLayouts {
+    // each entry as its id less the previous one, its port and its heartbeat
+    LIST_ENTRIES,
+    // one port for all, a bitmap of the ids present from the first, and the heartbeats in id order
+    LIST_BITMAP
+};
+
+/**
+ * Protocol modes, selected with PROTOCOL in the test case
+ */
+enum ProtocolModes {
+    HEARTBEAT_GOSSIP,
+    SWIM
+};
+
+/**
+ * Failure detectors of heartbeat gossip, selected with FD_MODE in the test case
+ */
+enum FailureDetectors {
+    FIXED_TIMEOUT,
+    PHI_ACCRUAL
+};
+
+/**
+ * Member states carried by SWIM updates
+ */
+enum SwimStates {
+    SWIM_ALIVE,
+    SWIM_SUSPECT,
+    SWIM_DEAD
+};
+
+/**
+ * STRUCT NAME: SwimUpdate
+ *
+ * DESCRIPTION: Membership change waiting to be piggybacked on SWIM messages
+ */
+typedef struct SwimUpdate {
+	int id;
+	short port;
+	long incarnation;
+	int state;
+	// number of messages it has been piggybacked on so far
+	int sent;
+}SwimUpdate;
+
+/**
+ * STRUCT NAME: SwimRelay
+ *
+ * DESCRIPTION: Indirect probe this node is running on behalf of another member
+ */
+typedef struct SwimRelay {
+	Address origin;
+	Address target;
+	int seq;
+	long expires;
+}SwimRelay;
+
 /**
  * STRUCT NAME: MessageHdr
  *
- * DESCRIPTION: Header and content of a message
+ * DESCRIPTION: Header and content of a message.
+ * 				One byte of MsgTypes and one of WIRE_VERSION, followed by the WireWriter encoded body.
  */
 typedef struct MessageHdr {
-	enum MsgTypes msgType;
+	unsigned char msgType;
+	unsigned char version;
 }MessageHdr;
 
 /**
@@ -56,12 +134,81 @@ private:
 	Params *par;
 	Member *memberNode;
 	char NULLADDR[6];
+	// Shuffled peer order walked by rotating gossip, and the next position in it
+	vector<Address> peerOrder;
+	size_t peerCursor;
+	// Membership table, this node included, in key order
+	MemberTable members;
+	// Slots found timed out by the last sweep, and the local tick before which no member
+	// can time out: the earliest deadline the sweep saw, pulled in by any set earlier since
+	vector<int> expiredSlots;
+	long sweepDue;
+	// Phi accrual: standard deviations past the mean interval at which phi reaches PHI_THRESHOLD
+	double phiDeviations;
+	// Members removed from the table as (id, global time), for the failure detector summary
+	vector< pair<int, int> > removals;
+	// Recently removed members with the heartbeat they had, so stale gossip cannot re-add them
+	vector<MemberListEntry> removedList;
+	// Bumped on every change to the membership table
+	long tableVersion;
+	// Full list as sent, chunk headers included, and where each chunk starts; rebuilt only
+	// once the table has changed since. Deltas are encoded into the scratch buffers next to it
+	vector<char> fullPayload;
+	vector<int> fullChunks;
+	bool fullPayloadStale;
+	vector<char> deltaPayload;
+	vector<int> deltaChunks;
+	// Slots being encoded, the first of each chunk, and the bitmap of the chunk being written
+	vector<int> encodeSlots;
+	vector<unsigned char> encodeBitmap;
+	// Received list being merged, the entries it updates as (slot, entry), the entries of
+	// members the table does not hold, and the members to be inserted
+	vector<int> recvIds;
+	vector<short> recvPorts;
+	vector<long> recvHeartbeats;
+	vector< pair<int, int> > mergeUpdated;
+	vector<int> mergeAdded;
+	vector<MemberListEntry> mergeInserts;
+	vector<int> encodeSplits;
+	// GOSSIP_BATCH: highest heartbeat received this tick for each slot of the table, LONG_MIN
+	// if none, and the slots that have one. Members not in the table are kept in the order
+	// first seen, with their position in it keyed by memberKey
+	vector<long> mergeHeartbeats;
+	vector<int> mergeSlots;
+	vector<MemberListEntry> mergeBatch;
+	unordered_map<long long, int> mergeIndex;
+	// Gossip rounds run so far, and the table version last gossiped to each peer
+	long gossipRound;
+	map<long long, long> peerVersion;
+	// SWIM: own incarnation and the probe of the current protocol period
+	long incarnation;
+	int probeSeq;
+	Address probeTarget;
+	long probeStart;
+	bool probeActive;
+	bool probeAcked;
+	bool probeIndirect;
+	// SWIM: suspected members with the local time suspicion started
+	map<long long, long> suspected;
+	// SWIM: changes still to be piggybacked, and indirect probes run for others
+	vector<SwimUpdate> updates;
+	vector<SwimRelay> relays;
+	// Random state of this node alone, so peer choices do not depend on which thread runs it
+	unsigned int rngSeed;
+	// Global time this node last ran at; the event-driven engine may leave gaps
+	long lastTick;
 
 public:
 	MP1Node(Member *, Params *, EmulNet *, Log *, Address *);
 	Member * getMemberNode() {
 		return memberNode;
 	}
+	MemberTable * getMembers() {
+		return &members;
+	}
+	vector< pair<int, int> > &getRemovals() {
+		return removals;
+	}
 	int recvLoop();
 	static int enqueueWrapper(void *env, char *buff, int size);
 	void nodeStart(char *servaddrstr, short serverport);
@@ -72,6 +219,9 @@ public:
 	void checkMessages();
 	bool recvCallBack(void *env, char *data, int size);
 	void nodeLoopOps();
+	void advanceClock();
+	void skipIdleTicks(long ticks);
+	long nextTick();
 	int isNullAddress(Address *addr);
 	Address getJoinAddress();
 	void initMemberListTable(Member *memberNode);
@@ -80,14 +230,42 @@ public:
 
 	string debugMessage(char *msg, int size);
 
-	void sendMembershipListTo(Address *toaddr, MsgTypes type);
+	void selectGossipTargets(vector<Address> &targets, int fanout, bool rotate);
+	static long long memberKey(int id, short port);
+	bool heartbeatNews(long before, long after);
+	void sendMembershipListTo(Address *toaddr, MsgTypes type, long sinceVersion = 0);
+	void multicastMembershipList(vector<Address> &targets, MsgTypes type);
+	void refreshFullPayload();
+	void encodeMembershipList(vector<char> &msg, vector<int> &chunks, long sinceVersion);
+	static long long bitmapSize(int firstId, int lastId, short port);
 	bool receiveMembershipList(char *data, int size); 
 
 	bool handleJoinRequestMessage(char *data, int size);
 	bool handleJoinReplyMessage(char *data, int size);
 	bool handleGossipMessage(char *data, int size);
 
+	bool isSelf(int id, short port);
+	int selfSlot();
 	void addMember(int id, short port, long heartbeat);
+	bool admitMember(int id, short port, long heartbeat);
+	void updateMember(int slot, long heartbeat);
+	long failureTimeout(int slot);
+	static double phiQuantile(double threshold);
+	MemberListEntry newMember(int id, short port, long heartbeat);
+	void forgetMember(int slot);
+	void batchMember(int id, short port, long heartbeat);
+	void batchSlot(int slot, long heartbeat);
+	void applyMergeBatch();
+	void removeMember(long long key);
+	void pruneRemovedList();
+
+	void swimLoopOps();
+	bool handleSwimMessage(char *data, int size);
+	void sendSwimMessage(Address *toaddr, MsgTypes type, int seq, Address *subject);
+	void swimApply(int id, short port, long incarnation, int state, bool disseminate);
+	void swimSuspect(Address *addr);
+	void swimDisseminate(int id, short port, long incarnation, int state);
+	int swimRetransmitLimit();
 };
 
 #endif /* _MP1NODE_H_ */
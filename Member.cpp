@@ -40,12 +40,12 @@ bool Address::operator ==(const Address& anotherAddress) {
 /**
  * Constructor
  */
-MemberListEntry::MemberListEntry(int id, short port, long heartbeat, long timestamp): id(id), port(port), heartbeat(heartbeat), timestamp(timestamp) {}
+MemberListEntry::MemberListEntry(int id, short port, long heartbeat, long timestamp): id(id), port(port), heartbeat(heartbeat), timestamp(timestamp), version(0) {}
 
 /**
  * Constuctor
  */
-MemberListEntry::MemberListEntry(int id, short port): id(id), port(port) {}
+MemberListEntry::MemberListEntry(int id, short port): id(id), port(port), version(0) {}
 
 /**
  * Copy constructor
@@ -55,6 +55,7 @@ MemberListEntry::MemberListEntry(const MemberListEntry &anotherMLE) {
 	this->id = anotherMLE.id;
 	this->port = anotherMLE.port;
 	this->timestamp = anotherMLE.timestamp;
+	this->version = anotherMLE.version;
 }
 
 /**
@@ -66,6 +67,7 @@ MemberListEntry& MemberListEntry::operator =(const MemberListEntry &anotherMLE)
 	swap(id, temp.id);
 	swap(port, temp.port);
 	swap(timestamp, temp.timestamp);
+	swap(version, temp.version);
 	return *this;
 }
 
@@ -105,6 +107,15 @@ long MemberListEntry::gettimestamp() {
 	return timestamp;
 }
 
+/**
+ * FUNCTION NAME: getversion
+ *
+ * DESCRIPTION: getter
+ */
+long MemberListEntry::getversion() {
+	return version;
+}
+
 /**
  * FUNCTION NAME: setid
  *
@@ -141,6 +152,15 @@ void MemberListEntry::settimestamp(long timestamp) {
 	this->timestamp = timestamp;
 }
 
+/**
+ * FUNCTION NAME: setversion
+ *
+ * DESCRIPTION: setter
+ */
+void MemberListEntry::setversion(long version) {
+	this->version = version;
+}
+
 /**
  * Copy Constructor
  */
@@ -65,19 +65,23 @@ public:
 	short port;
 	long heartbeat;
 	long timestamp;
+	// table version at which this entry last changed
+	long version;
 	MemberListEntry(int id, short port, long heartbeat, long timestamp);
 	MemberListEntry(int id, short port);
-	MemberListEntry(): id(0), port(0), heartbeat(0), timestamp(0) {}
+	MemberListEntry(): id(0), port(0), heartbeat(0), timestamp(0), version(0) {}
 	MemberListEntry(const MemberListEntry &anotherMLE);
 	MemberListEntry& operator =(const MemberListEntry &anotherMLE);
 	int getid();
 	short getport();
 	long getheartbeat();
 	long gettimestamp();
+	long getversion();
 	void setid(int id);
 	void setport(short port);
 	void setheartbeat(long hearbeat);
 	void settimestamp(long timestamp);
+	void setversion(long version);
 };
 
 /**
@@ -0,0 +1,437 @@
+/**********************************
+ * FILE NAME: MemberTable.cpp
+ *
+ * DESCRIPTION: Definition of the membership table
+ **********************************/
+
+#include "MemberTable.h"
+
+/**
+ * FUNCTION NAME: key
+ *
+ * DESCRIPTION: Single integer identifying a member by id and port, in the table's order
+ */
+long long MemberTable::key(int id, short port) {
+	return ((long long)id << 16) | (unsigned short)port;
+}
+
+/**
+ * FUNCTION NAME: size
+ *
+ * DESCRIPTION: Number of entries
+ */
+int MemberTable::size() {
+	return (int)ids.size();
+}
+
+/**
+ * FUNCTION NAME: clear
+ *
+ * DESCRIPTION: Drop every entry, keeping the arrays' capacity
+ */
+void MemberTable::clear() {
+	resize(0);
+}
+
+/**
+ * FUNCTION NAME: lowerBound
+ *
+ * DESCRIPTION: First slot whose key is not below key
+ */
+int MemberTable::lowerBound(long long key) {
+	int lo = 0;
+	int hi = size();
+	while ( lo < hi ) {
+		int mid = (lo + hi) / 2;
+		if ( MemberTable::key(ids[mid], ports[mid]) < key ) {
+			lo = mid + 1;
+		}
+		else {
+			hi = mid;
+		}
+	}
+	return lo;
+}
+
+/**
+ * FUNCTION NAME: search
+ *
+ * DESCRIPTION: Slot of the member with the given key by binary search, -1 if it is not in the table
+ */
+int MemberTable::search(long long key) {
+	int slot = lowerBound(key);
+	if ( slot < size() && MemberTable::key(ids[slot], ports[slot]) == key ) {
+		return slot;
+	}
+	return -1;
+}
+
+/**
+ * FUNCTION NAME: find
+ *
+ * DESCRIPTION: Slot of the member with the given key, -1 if it is not in the table
+ */
+int MemberTable::find(long long key) {
+	return find((int)(key >> 16), (short)(key & 0xFFFF));
+}
+
+/**
+ * FUNCTION NAME: find
+ *
+ * DESCRIPTION: Slot of the member, -1 if it is not in the table. The slot map answers
+ * 				for ids it holds; members it does not know of take a binary search.
+ */
+int MemberTable::find(int id, short port) {
+	if ( id >= 0 && id < (int)index.size() ) {
+		int slot = index[id];
+		if ( slot >= 0 && slot < size() && ids[slot] == id && ports[slot] == port ) {
+			return slot;
+		}
+	}
+	return search(key(id, port));
+}
+
+/**
+ * FUNCTION NAME: reindex
+ *
+ * DESCRIPTION: Point the slot map at every slot from from on, after entries moved.
+ * 				It grows to cover ids up to twice the table size, which holds every
+ * 				member while ids stay dense; any other id is left to binary search.
+ */
+void MemberTable::reindex(int from) {
+	int limit = 2 * size() + 64;
+	for ( int slot = from; slot < size(); slot++ ) {
+		int id = ids[slot];
+		if ( id < 0 || id >= limit ) {
+			continue;
+		}
+		if ( id >= (int)index.size() ) {
+			index.resize(id + 1, -1);
+		}
+		index[id] = slot;
+	}
+}
+
+/**
+ * FUNCTION NAME: add
+ *
+ * DESCRIPTION: Insert a member the table does not hold yet in its place and return its slot.
+ * 				It times out timeout ticks after timestamp, and has no arrival history.
+ * 				Moves every later entry; use insertAll for more than a few.
+ */
+int MemberTable::add(int id, short port, long heartbeat, long timestamp, long version, long timeout) {
+	int slot = lowerBound(key(id, port));
+	ids.insert(ids.begin() + slot, id);
+	ports.insert(ports.begin() + slot, port);
+	heartbeats.insert(heartbeats.begin() + slot, heartbeat);
+	timestamps.insert(timestamps.begin() + slot, (int)timestamp);
+	deadlines.insert(deadlines.begin() + slot, (int)(timestamp + timeout));
+	arrivals.insert(arrivals.begin() + slot, ArrivalWindow());
+	versions.insert(versions.begin() + slot, version);
+	reindex(slot);
+	return slot;
+}
+
+/**
+ * FUNCTION NAME: insertAll
+ *
+ * DESCRIPTION: Insert members the table does not hold yet, in one pass from the back
+ * 				that moves every entry at most once. Each times out timeout ticks after its
+ * 				timestamp, and has no arrival history. Sorts entries.
+ */
+void MemberTable::insertAll(vector<MemberListEntry> &entries, long timeout) {
+	if ( entries.empty() ) {
+		return;
+	}
+	sort(entries.begin(), entries.end(), [](const MemberListEntry &a, const MemberListEntry &b) {
+		return key(a.id, a.port) < key(b.id, b.port);
+	});
+
+	int j = size() - 1;
+	int k = (int)entries.size() - 1;
+	resize(size() + entries.size());
+	for ( int slot = size() - 1; k >= 0; slot-- ) {
+		MemberListEntry &e = entries[k];
+		if ( j >= 0 && key(ids[j], ports[j]) > key(e.id, e.port) ) {
+			move(j--, slot);
+			continue;
+		}
+		ids[slot] = e.id;
+		ports[slot] = e.port;
+		heartbeats[slot] = e.heartbeat;
+		timestamps[slot] = (int)e.timestamp;
+		deadlines[slot] = (int)(e.timestamp + timeout);
+		arrivals[slot] = ArrivalWindow();
+		versions[slot] = e.version;
+		k--;
+	}
+	reindex(j + 1);
+}
+
+/**
+ * FUNCTION NAME: merge
+ *
+ * DESCRIPTION: Match a list of n entries sorted by key against the table in one walk of
+ * 				both. Entries with a heartbeat above both floor and the member's go to updated
+ * 				as (slot, entry) pairs, entries of members the table does not hold to added.
+ * 				Where four entries in a row meet the same four members, which is the usual
+ * 				case, the ids, ports and heartbeats of all four are compared at once.
+ *
+ * RETURNS:
+ * false, with nothing added to updated and added, if the list is not sorted
+ */
+bool MemberTable::merge(const int *inIds, const short *inPorts, const long *inHeartbeats, int n,
+		long floor, vector< pair<int, int> > &updated, vector<int> &added) {
+	for ( int i = 1; i < n; i++ ) {
+		if ( key(inIds[i - 1], inPorts[i - 1]) >= key(inIds[i], inPorts[i]) ) {
+			return false;
+		}
+	}
+	if ( n == 0 ) {
+		return true;
+	}
+
+	int m = size();
+	int i = 0;
+	int j = lowerBound(key(inIds[0], inPorts[0]));
+	while ( i < n && j < m ) {
+#ifdef __SSE2__
+		if ( i + 4 <= n && j + 4 <= m ) {
+			__m128i sameIds = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)(inIds + i)), _mm_loadu_si128((const __m128i *)(ids.data() + j)));
+			__m128i samePorts = _mm_cmpeq_epi16(_mm_loadl_epi64((const __m128i *)(inPorts + i)), _mm_loadl_epi64((const __m128i *)(ports.data() + j)));
+			if ( _mm_movemask_ps(_mm_castsi128_ps(sameIds)) == 0xF && (_mm_movemask_epi8(samePorts) & 0xFF) == 0xFF ) {
+				// No 64-bit compare in SSE2: a - b is negative exactly when a < b, heartbeats
+				// being far from overflow, and movemask_pd reads the sign of each lane
+				__m128i low = _mm_set1_epi64x(floor);
+				for ( int h = 0; h < 4; h += 2 ) {
+					__m128i in = _mm_loadu_si128((const __m128i *)(inHeartbeats + i + h));
+					__m128i newer = _mm_sub_epi64(_mm_loadu_si128((const __m128i *)(heartbeats.data() + j + h)), in);
+					__m128i live = _mm_sub_epi64(low, in);
+					int mask = _mm_movemask_pd(_mm_castsi128_pd(_mm_and_si128(newer, live)));
+					for ( int lane = 0; lane < 2; lane++ ) {
+						if ( mask & (1 << lane) ) {
+							updated.push_back(make_pair(j + h + lane, i + h + lane));
+						}
+					}
+				}
+				i += 4;
+				j += 4;
+				continue;
+			}
+		}
+#endif
+		long long in = key(inIds[i], inPorts[i]);
+		long long have = key(ids[j], ports[j]);
+		if ( have < in ) {
+			j++;
+		}
+		else if ( have > in ) {
+			added.push_back(i++);
+		}
+		else {
+			if ( inHeartbeats[i] > heartbeats[j] && inHeartbeats[i] > floor ) {
+				updated.push_back(make_pair(j, i));
+			}
+			i++;
+			j++;
+		}
+	}
+	for ( ; i < n; i++ ) {
+		added.push_back(i);
+	}
+	return true;
+}
+
+/**
+ * FUNCTION NAME: addArrival
+ *
+ * DESCRIPTION: Record interval ticks between two heartbeats of the member in slot,
+ * 				in place of the oldest once the window is full
+ */
+void MemberTable::addArrival(int slot, int interval) {
+	ArrivalWindow &w = arrivals[slot];
+	if ( w.count == FD_WINDOW ) {
+		int old = w.samples[w.next];
+		w.sum -= old;
+		w.squares -= (long)old * old;
+	}
+	else {
+		w.count++;
+	}
+	w.samples[w.next] = interval;
+	w.next = (w.next + 1) % FD_WINDOW;
+	w.sum += interval;
+	w.squares += (long)interval * interval;
+}
+
+/**
+ * FUNCTION NAME: expired
+ *
+ * DESCRIPTION: Append to slots, in increasing order, every slot whose deadline is
+ * 				at most now. Eight deadlines are compared per step and
+ * 				a step in which none expired, the usual case, costs a single branch.
+ *
+ * RETURNS:
+ * earliest deadline of the other slots, INT_MAX if there is none
+ */
+long MemberTable::expired(long now, vector<int> &slots) {
+	int n = size();
+	int i = 0;
+	int low = INT_MAX;
+	const int *ts = deadlines.data();
+
+	if ( now < INT_MIN ) {
+		return earliest();
+	}
+	int limit = (now > INT_MAX) ? INT_MAX : (int)now;
+
+#ifdef __SSE2__
+	if ( i + 8 <= n ) {
+		int lanes[4];
+		__m128i lim = _mm_set1_epi32(limit);
+		__m128i none = _mm_set1_epi32(INT_MAX);
+		__m128i acc = none;
+		for ( ; i + 8 <= n; i += 8 ) {
+			__m128i vlo = _mm_loadu_si128((const __m128i *)(ts + i));
+			__m128i vhi = _mm_loadu_si128((const __m128i *)(ts + i + 4));
+			// Lanes still alive are all ones
+			__m128i lo = _mm_cmpgt_epi32(vlo, lim);
+			__m128i hi = _mm_cmpgt_epi32(vhi, lim);
+			// Expired lanes take part in the minimum as INT_MAX
+			vlo = _mm_or_si128(_mm_and_si128(lo, vlo), _mm_andnot_si128(lo, none));
+			vhi = _mm_or_si128(_mm_and_si128(hi, vhi), _mm_andnot_si128(hi, none));
+			__m128i less = _mm_cmplt_epi32(vlo, vhi);
+			vlo = _mm_or_si128(_mm_and_si128(less, vlo), _mm_andnot_si128(less, vhi));
+			less = _mm_cmplt_epi32(vlo, acc);
+			acc = _mm_or_si128(_mm_and_si128(less, vlo), _mm_andnot_si128(less, acc));
+			if ( _mm_movemask_epi8(_mm_and_si128(lo, hi)) == 0xFFFF ) {
+				continue;
+			}
+			int dead = ~(_mm_movemask_ps(_mm_castsi128_ps(lo)) | (_mm_movemask_ps(_mm_castsi128_ps(hi)) << 4)) & 0xFF;
+			while ( dead ) {
+				slots.push_back(i + __builtin_ctz(dead));
+				dead &= dead - 1;
+			}
+		}
+		_mm_storeu_si128((__m128i *)lanes, acc);
+		for ( int k = 0; k < 4; k++ ) {
+			low = min(low, lanes[k]);
+		}
+	}
+#endif
+
+	for ( ; i < n; i++ ) {
+		if ( ts[i] <= limit ) {
+			slots.push_back(i);
+		}
+		else {
+			low = min(low, ts[i]);
+		}
+	}
+	return low;
+}
+
+/**
+ * FUNCTION NAME: earliest
+ *
+ * DESCRIPTION: Earliest deadline, INT_MAX if the table is empty
+ */
+long MemberTable::earliest() {
+	int n = size();
+	int i = 0;
+	int low = INT_MAX;
+	const int *ts = deadlines.data();
+
+#ifdef __SSE2__
+	if ( i + 4 <= n ) {
+		int lanes[4];
+		// SSE2 has no 32-bit min; select through the compare mask instead
+		__m128i acc = _mm_set1_epi32(INT_MAX);
+		for ( ; i + 4 <= n; i += 4 ) {
+			__m128i v = _mm_loadu_si128((const __m128i *)(ts + i));
+			__m128i less = _mm_cmplt_epi32(v, acc);
+			acc = _mm_or_si128(_mm_and_si128(less, v), _mm_andnot_si128(less, acc));
+		}
+		_mm_storeu_si128((__m128i *)lanes, acc);
+		for ( int k = 0; k < 4; k++ ) {
+			low = min(low, lanes[k]);
+		}
+	}
+#endif
+
+	for ( ; i < n; i++ ) {
+		low = min(low, ts[i]);
+	}
+	return low;
+}
+
+/**
+ * FUNCTION NAME: move
+ *
+ * DESCRIPTION: Copy the entry in slot from over slot to
+ */
+void MemberTable::move(int from, int to) {
+	ids[to] = ids[from];
+	ports[to] = ports[from];
+	heartbeats[to] = heartbeats[from];
+	timestamps[to] = timestamps[from];
+	deadlines[to] = deadlines[from];
+	arrivals[to] = arrivals[from];
+	versions[to] = versions[from];
+}
+
+/**
+ * FUNCTION NAME: resize
+ *
+ * DESCRIPTION: Grow or shrink every array to size entries
+ */
+void MemberTable::resize(int size) {
+	ids.resize(size);
+	ports.resize(size);
+	heartbeats.resize(size);
+	timestamps.resize(size);
+	deadlines.resize(size);
+	arrivals.resize(size);
+	versions.resize(size);
+}
+
+/**
+ * FUNCTION NAME: remove
+ *
+ * DESCRIPTION: Remove one entry, moving the later ones down
+ */
+void MemberTable::remove(int slot) {
+	ids.erase(ids.begin() + slot);
+	ports.erase(ports.begin() + slot);
+	heartbeats.erase(heartbeats.begin() + slot);
+	timestamps.erase(timestamps.begin() + slot);
+	deadlines.erase(deadlines.begin() + slot);
+	arrivals.erase(arrivals.begin() + slot);
+	versions.erase(versions.begin() + slot);
+	reindex(slot);
+}
+
+/**
+ * FUNCTION NAME: removeAll
+ *
+ * DESCRIPTION: Remove the entries in slots, given in increasing order, compacting the
+ * 				rest in one pass
+ */
+void MemberTable::removeAll(vector<int> &slots) {
+	if ( slots.empty() ) {
+		return;
+	}
+
+	int n = size();
+	int kept = slots[0];
+	unsigned int next = 0;
+	for ( int i = slots[0]; i < n; i++ ) {
+		if ( next < slots.size() && slots[next] == i ) {
+			next++;
+			continue;
+		}
+		move(i, kept++);
+	}
+	resize(kept);
+	reindex(slots[0]);
+}
@@ -0,0 +1,84 @@
+/**********************************
+ * FILE NAME: MemberTable.h
+ *
+ * DESCRIPTION: Header file of the membership table
+ **********************************/
+
+#ifndef _MEMBERTABLE_H_
+#define _MEMBERTABLE_H_
+
+#include "stdincludes.h"
+#include "Member.h"
+#include <limits.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/*
+ * Macros
+ */
+// heartbeat inter-arrival times kept per member
+#define FD_WINDOW 16
+
+/**
+ * STRUCT NAME: ArrivalWindow
+ *
+ * DESCRIPTION: Ring of the last FD_WINDOW intervals between a member's heartbeats,
+ * 				in local ticks, with their running sum and sum of squares
+ */
+typedef struct ArrivalWindow {
+	int samples[FD_WINDOW];
+	int count;
+	int next;
+	long sum;
+	long squares;
+}ArrivalWindow;
+
+/**
+ * CLASS NAME: MemberTable
+ *
+ * DESCRIPTION: Membership table kept as one array per field, so that sweeping the
+ * 				timestamps touches nothing else, and sorted by key, so that a received
+ * 				list in the same order merges in one walk. Node ids are handed out densely,
+ * 				so members are found by indexing a slot map with their id, falling back to
+ * 				binary search for ids it does not cover; inserting and removing move the
+ * 				later entries.
+ * 				Timestamps and deadlines are local ticks, kept in 32 bits so four share
+ * 				an SSE2 compare.
+ */
+class MemberTable {
+private:
+	// Slot of each id below its size as of the last move, checked before it is trusted
+	vector<int> index;
+	int lowerBound(long long key);
+	int search(long long key);
+	void reindex(int from);
+	void move(int from, int to);
+	void resize(int size);
+public:
+	vector<int> ids;
+	vector<short> ports;
+	vector<long> heartbeats;
+	vector<int> timestamps;
+	// tick at which each member times out unless heard from again
+	vector<int> deadlines;
+	vector<ArrivalWindow> arrivals;
+	// table version at which each entry last changed
+	vector<long> versions;
+	static long long key(int id, short port);
+	int size();
+	void clear();
+	int find(long long key);
+	int find(int id, short port);
+	int add(int id, short port, long heartbeat, long timestamp, long version, long timeout);
+	void insertAll(vector<MemberListEntry> &entries, long timeout);
+	bool merge(const int *inIds, const short *inPorts, const long *inHeartbeats, int n,
+			long floor, vector< pair<int, int> > &updated, vector<int> &added);
+	void addArrival(int slot, int interval);
+	long expired(long now, vector<int> &slots);
+	long earliest();
+	void remove(int slot);
+	void removeAll(vector<int> &slots);
+};
+
+#endif /* _MEMBERTABLE_H_ */
@@ -0,0 +1,153 @@
+/**********************************
+ * FILE NAME: MsgPool.cpp
+ *
+ * DESCRIPTION: Definition of the message buffer pool
+ **********************************/
+
+#include "MsgPool.h"
+
+/**
+ * Constructor
+ */
+MsgPool::MsgPool() {
+	for ( int i = 0; i < POOL_CLASSES; i++ ) {
+		freeList[i] = NULL;
+	}
+	memset(&stats, 0, sizeof(stats));
+}
+
+/**
+ * Copy constructor
+ *
+ * Blocks belong to the slabs of the pool that handed them out, so a copy starts empty
+ */
+MsgPool::MsgPool(const MsgPool &anotherPool) {
+	for ( int i = 0; i < POOL_CLASSES; i++ ) {
+		freeList[i] = NULL;
+	}
+	memset(&stats, 0, sizeof(stats));
+}
+
+/**
+ * Assignment operator overloading
+ */
+MsgPool& MsgPool::operator =(const MsgPool &anotherPool) {
+	return *this;
+}
+
+/**
+ * Destructor
+ */
+MsgPool::~MsgPool() {
+	for ( unsigned int i = 0; i < slabs.size(); i++ ) {
+		::free(slabs[i]);
+	}
+}
+
+/**
+ * FUNCTION NAME: sizeClass
+ *
+ * DESCRIPTION: Index of the smallest class that fits size, -1 if it needs malloc
+ */
+int MsgPool::sizeClass(int size) {
+	int cls = 0;
+	int block = POOL_MIN_BLOCK;
+	while ( block < size ) {
+		block <<= 1;
+		cls++;
+	}
+	return (cls < POOL_CLASSES) ? cls : -1;
+}
+
+/**
+ * FUNCTION NAME: refill
+ *
+ * DESCRIPTION: Carve a new slab into blocks of the given class
+ */
+void MsgPool::refill(int cls) {
+	int block = POOL_MIN_BLOCK << cls;
+	char *slab = (char *) malloc(POOL_SLAB_SIZE);
+	slabs.push_back(slab);
+	stats.slabs++;
+
+	for ( int off = POOL_SLAB_SIZE - block; off >= 0; off -= block ) {
+		FreeBlock *b = (FreeBlock *)(slab + off);
+		b->next = freeList[cls];
+		freeList[cls] = b;
+	}
+}
+
+/**
+ * FUNCTION NAME: alloc
+ *
+ * DESCRIPTION: Hand out a buffer of at least size bytes
+ */
+char *MsgPool::alloc(int size) {
+	int cls = sizeClass(size);
+	char *block;
+	lock_guard<mutex> guard(lock);
+
+	if ( cls < 0 ) {
+		stats.oversize++;
+		block = (char *) malloc(size);
+	}
+	else {
+		if ( freeList[cls] == NULL ) {
+			refill(cls);
+		}
+		block = (char *) freeList[cls];
+		freeList[cls] = freeList[cls]->next;
+	}
+
+	stats.allocs++;
+	stats.inuse += size;
+	if ( stats.inuse > stats.peak ) {
+		stats.peak = stats.inuse;
+	}
+	return block;
+}
+
+/**
+ * FUNCTION NAME: free
+ *
+ * DESCRIPTION: Give back a buffer obtained from alloc with the same size
+ */
+void MsgPool::free(char *block, int size) {
+	if ( block == NULL ) {
+		return;
+	}
+
+	int cls = sizeClass(size);
+	lock_guard<mutex> guard(lock);
+	if ( cls < 0 ) {
+		::free(block);
+	}
+	else {
+		FreeBlock *b = (FreeBlock *)block;
+		b->next = freeList[cls];
+		freeList[cls] = b;
+	}
+
+	stats.frees++;
+	stats.inuse -= size;
+}
+
+/**
+ * FUNCTION NAME: getStats
+ *
+ * DESCRIPTION: getter
+ */
+PoolStats MsgPool::getStats() {
+	lock_guard<mutex> guard(lock);
+	return stats;
+}
+
+/**
+ * FUNCTION NAME: printStats
+ *
+ * DESCRIPTION: Write the pool counters to file
+ */
+void MsgPool::printStats(FILE *file) {
+	fprintf(file, "msgpool allocs %ld frees %ld slabs %ld oversize %ld inuse %ld peak %ld\n",
+			stats.allocs, stats.frees, stats.slabs, stats.oversize, stats.inuse, stats.peak);
+}
@@ -0,0 +1,71 @@
+/**********************************
+ * FILE NAME: MsgPool.h
+ *
+ * DESCRIPTION: Header file of the message buffer pool
+ **********************************/
+
+#ifndef _MSGPOOL_H_
+#define _MSGPOOL_H_
+
+#include "stdincludes.h"
+
+/*
+ * Macros
+ */
+// smallest and largest block handed out from a slab, both powers of two
+#define POOL_MIN_BLOCK 16
+#define POOL_MAX_BLOCK 4096
+#define POOL_CLASSES 9
+// bytes requested from the system each time a size class runs dry
+#define POOL_SLAB_SIZE (64 * 1024)
+
+/**
+ * STRUCT NAME: PoolStats
+ *
+ * DESCRIPTION: Counters describing how the pool has been used
+ */
+typedef struct PoolStats {
+	// blocks handed out / given back
+	long allocs;
+	long frees;
+	// slabs requested from the system
+	long slabs;
+	// requests larger than POOL_MAX_BLOCK, served by malloc
+	long oversize;
+	// bytes currently handed out and the highest value seen
+	long inuse;
+	long peak;
+}PoolStats;
+
+/**
+ * CLASS NAME: MsgPool
+ *
+ * DESCRIPTION: Size-class slab allocator for short-lived message buffers.
+ * 				Freed blocks go back to the free list of their class and are
+ * 				reused by the next request; slabs are returned in bulk when the
+ * 				pool is destroyed. Safe to use from several threads.
+ */
+class MsgPool {
+private:
+	struct FreeBlock {
+		FreeBlock *next;
+	};
+	FreeBlock *freeList[POOL_CLASSES];
+	vector<char *> slabs;
+	PoolStats stats;
+	// nodes running on different threads share the pool
+	mutex lock;
+	static int sizeClass(int size);
+	void refill(int cls);
+public:
+	MsgPool();
+	MsgPool(const MsgPool &anotherPool);
+	MsgPool& operator =(const MsgPool &anotherPool);
+	virtual ~MsgPool();
+	char *alloc(int size);
+	void free(char *block, int size);
+	PoolStats getStats();
+	void printStats(FILE *file);
+};
+
+#endif /* _MSGPOOL_H_ */
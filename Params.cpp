@@ -18,17 +18,52 @@ Params::Params(): PORTNUM(8001) {}
  */
 void Params::setparams(char *config_file) {
 	FILE *fp = fopen(config_file,"r");
+	char key[64];
+	double value;
+
+	MAX_MSG_SIZE = 4000;
+	TRANSPORT = 0;
+	SHM_KEY = 0;
+	SHM_NODES = 0;
+	SHM_SLOTS = 256;
+	COALESCE = 0;
+	LATENCY_DIST = 0;
+	LATENCY_MEAN = 0;
+	LATENCY_JITTER = 0;
+	LINK_BANDWIDTH = 0;
+	GOSSIP_FANOUT = 0;
+	GOSSIP_ROTATE = 0;
+	GOSSIP_DELTA = 0;
+	GOSSIP_FULL_EVERY = 4;
+	GOSSIP_DELTA_STEP = 1;
+	GOSSIP_BATCH = 0;
+	PROTOCOL = 0;
+	FD_MODE = 0;
+	PHI_THRESHOLD = 8;
+	// a period fits a ping, the ping-req round trip through a helper and its forwarded ack
+	SWIM_PERIOD = 6;
+	SWIM_HELPERS = 3;
+	SWIM_SUSPECT = 20;
+	THREADS = 1;
+	SEED = 0;
+	SIM_MODE = 0;
+	RUN_TIME = 0;
+	TICK_USEC = 100000;
 
 	fscanf(fp,"MAX_NNB: %d", &MAX_NNB);
 	fscanf(fp,"\nSINGLE_FAILURE: %d", &SINGLE_FAILURE);
 	fscanf(fp,"\nDROP_MSG: %d", &DROP_MSG);
 	fscanf(fp,"\nMSG_DROP_PROB: %lf", &MSG_DROP_PROB);
 
+	// Optional settings follow, one "KEY: value" per line
+	while ( fscanf(fp, " %63[^:]: %lf", key, &value) == 2 ) {
+		setparam(key, value);
+	}
+
 	//printf("Parameters of the test case: %d %d %d %lf\n", MAX_NNB, SINGLE_FAILURE, DROP_MSG, MSG_DROP_PROB);
 
 	EN_GPSZ = MAX_NNB;
 	STEP_RATE=.25;
-	MAX_MSG_SIZE = 4000;
 	globaltime = 0;
 	dropmsg = 0;
 	allNodesJoined = 0;
@@ -39,6 +74,102 @@ void Params::setparams(char *config_file) {
 	return;
 }
 
+/**
+ * FUNCTION NAME: setparam
+ *
+ * DESCRIPTION: Set one optional parameter read from the test case
+ */
+void Params::setparam(const char *key, double value) {
+	if ( strcmp(key, "TRANSPORT") == 0 ) {
+		TRANSPORT = (int) value;
+	}
+	else if ( strcmp(key, "SHM_KEY") == 0 ) {
+		SHM_KEY = (int) value;
+	}
+	else if ( strcmp(key, "SHM_NODES") == 0 ) {
+		SHM_NODES = (int) value;
+	}
+	else if ( strcmp(key, "SHM_SLOTS") == 0 ) {
+		SHM_SLOTS = (int) value;
+	}
+	else if ( strcmp(key, "MAX_MSG_SIZE") == 0 ) {
+		MAX_MSG_SIZE = (int) value;
+		if ( MAX_MSG_SIZE < MIN_MSG_SIZE ) {
+			printf("MAX_MSG_SIZE %d too small, using %d\n", MAX_MSG_SIZE, MIN_MSG_SIZE);
+			MAX_MSG_SIZE = MIN_MSG_SIZE;
+		}
+	}
+	else if ( strcmp(key, "COALESCE") == 0 ) {
+		COALESCE = (int) value;
+	}
+	else if ( strcmp(key, "LATENCY_DIST") == 0 ) {
+		LATENCY_DIST = (int) value;
+	}
+	else if ( strcmp(key, "LATENCY_MEAN") == 0 ) {
+		LATENCY_MEAN = value;
+	}
+	else if ( strcmp(key, "LATENCY_JITTER") == 0 ) {
+		LATENCY_JITTER = value;
+	}
+	else if ( strcmp(key, "LINK_BANDWIDTH") == 0 ) {
+		LINK_BANDWIDTH = value;
+	}
+	else if ( strcmp(key, "GOSSIP_FANOUT") == 0 ) {
+		GOSSIP_FANOUT = (int) value;
+	}
+	else if ( strcmp(key, "GOSSIP_ROTATE") == 0 ) {
+		GOSSIP_ROTATE = (int) value;
+	}
+	else if ( strcmp(key, "GOSSIP_DELTA") == 0 ) {
+		GOSSIP_DELTA = (int) value;
+	}
+	else if ( strcmp(key, "GOSSIP_FULL_EVERY") == 0 ) {
+		GOSSIP_FULL_EVERY = (int) value;
+	}
+	else if ( strcmp(key, "GOSSIP_DELTA_STEP") == 0 ) {
+		GOSSIP_DELTA_STEP = (int) value;
+	}
+	else if ( strcmp(key, "GOSSIP_BATCH") == 0 ) {
+		GOSSIP_BATCH = (int) value;
+	}
+	else if ( strcmp(key, "PROTOCOL") == 0 ) {
+		PROTOCOL = (int) value;
+	}
+	else if ( strcmp(key, "FD_MODE") == 0 ) {
+		FD_MODE = (int) value;
+	}
+	else if ( strcmp(key, "PHI_THRESHOLD") == 0 ) {
+		PHI_THRESHOLD = value;
+	}
+	else if ( strcmp(key, "SWIM_PERIOD") == 0 ) {
+		SWIM_PERIOD = (int) value;
+	}
+	else if ( strcmp(key, "SWIM_HELPERS") == 0 ) {
+		SWIM_HELPERS = (int) value;
+	}
+	else if ( strcmp(key, "SWIM_SUSPECT") == 0 ) {
+		SWIM_SUSPECT = (int) value;
+	}
+	else if ( strcmp(key, "THREADS") == 0 ) {
+		THREADS = (int) value;
+	}
+	else if ( strcmp(key, "SEED") == 0 ) {
+		SEED = (unsigned int) value;
+	}
+	else if ( strcmp(key, "SIM_MODE") == 0 ) {
+		SIM_MODE = (int) value;
+	}
+	else if ( strcmp(key, "RUN_TIME") == 0 ) {
+		RUN_TIME = (int) value;
+	}
+	else if ( strcmp(key, "TICK_USEC") == 0 ) {
+		TICK_USEC = (int) value;
+	}
+	else {
+		printf("Unknown parameter %s ignored\n", key);
+	}
+}
+
 /**
  * FUNCTION NAME: getcurrtime
  *
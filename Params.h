@@ -11,6 +11,9 @@
 #include "Params.h"
 #include "Member.h"
 
+// Smallest MAX_MSG_SIZE taken: the network's headers, a membership chunk header and one entry
+#define MIN_MSG_SIZE 128
+
 enum testTYPE { CREATE_TEST, READ_TEST, UPDATE_TEST, DELETE_TEST };
 
 /**
@@ -25,14 +28,42 @@ public:
 	double MSG_DROP_PROB;		// message drop probability
 	double STEP_RATE;		    // dictates the rate of insertion
 	int EN_GPSZ;			    // actual number of peers
-	int MAX_MSG_SIZE;
+	int MAX_MSG_SIZE;			// largest envelope the network carries, headers included
 	int DROP_MSG;
+	int TRANSPORT;				// 0 emulated network, 1 UDP on 127.0.0.1, 2 shared memory
+	int SHM_KEY;				// shared memory region to attach, 0 for one private to the process (Application only)
+	int SHM_NODES;				// nodes the shared memory region has room for, 0 for MAX_NNB
+	int SHM_SLOTS;				// messages each shared memory inbox holds, rounded up to a power of two
+	int COALESCE;				// 1 packs the messages a node sends a destination in a tick into one envelope
+	int LATENCY_DIST;			// delay distribution: 0 constant, 1 uniform, 2 exponential, 3 normal
+	double LATENCY_MEAN;		// mean extra delivery delay, in ticks
+	double LATENCY_JITTER;		// half-width (uniform) or standard deviation (normal) of the delay
+	double LINK_BANDWIDTH;		// bytes per tick a link carries, 0 for unlimited
 	int dropmsg;
 	int globaltime;
 	int allNodesJoined;
 	short PORTNUM;
+	int GOSSIP_FANOUT;			// peers gossiped to per round, 0 means every member
+	int GOSSIP_ROTATE;			// walk a shuffled peer order instead of sampling each round
+	int GOSSIP_DELTA;			// gossip only entries changed since the last exchange with a peer
+	int GOSSIP_FULL_EVERY;		// with GOSSIP_DELTA, send the full list every this many rounds
+	int GOSSIP_DELTA_STEP;		// with GOSSIP_DELTA, heartbeat advance that makes an entry changed
+	int GOSSIP_BATCH;			// 1 merges the lists received in a tick at once, highest heartbeat per member
+	int PROTOCOL;				// 0 heartbeat gossip, 1 SWIM ping/ping-req
+	int FD_MODE;				// heartbeat gossip: 0 fixed TFAIL + TREMOVE timeout, 1 phi accrual
+	double PHI_THRESHOLD;		// with FD_MODE 1, suspicion level at which a member is removed
+	int SWIM_PERIOD;			// ticks per SWIM protocol period
+	int SWIM_HELPERS;			// members asked to probe indirectly when a ping goes unanswered
+	int SWIM_SUSPECT;			// ticks a suspected member has to refute before it is removed
+	int THREADS;				// worker threads running the nodes of a tick
+	unsigned int SEED;			// random seed, 0 picks one from the clock
+	int SIM_MODE;				// 0 run every node every tick, 1 run nodes only when they have work
+	int RUN_TIME;				// ticks simulated, 0 for the default length (Daemon: run until signalled)
+	int TICK_USEC;				// Daemon: wall-clock length of a tick, in microseconds
+	string LOG_PREFIX;			// put in front of every log file name, so several daemons can share a directory
 	Params();
 	void setparams(char *);
+	void setparam(const char *key, double value);
 	int getcurrtime();
 };
 
@@ -0,0 +1,321 @@
+/**********************************
+ * FILE NAME: ShmNet.cpp
+ *
+ * DESCRIPTION: Shared-memory transport definition
+ **********************************/
+
+#include "ShmNet.h"
+
+/**
+ * Constructor
+ *
+ * The first process to open the region lays it out; later ones wait for it to be
+ * ready and check it has the geometry their own parameters ask for.
+ */
+ShmNet::ShmNet(Params *p): EmulNet(p) {
+	struct stat st;
+	int waited = 0;
+
+	unsigned int nodes = (par->SHM_NODES > 0) ? par->SHM_NODES : par->EN_GPSZ;
+	if ( par->SHM_SLOTS > (int)SHM_MAX_SLOTS ) {
+		fprintf(stderr, "ShmNet: SHM_SLOTS %d is above %u\n", par->SHM_SLOTS, SHM_MAX_SLOTS);
+		exit(1);
+	}
+	// A ring of one could not tell a full cell from one free for the next lap
+	unsigned int slots = 2;
+	while ( slots < (unsigned int)par->SHM_SLOTS ) {
+		slots <<= 1;
+	}
+	unsigned int cellSize = (sizeof(shm_cell) + par->MAX_MSG_SIZE + SHM_LINE - 1) / SHM_LINE * SHM_LINE;
+	inboxSize = sizeof(shm_inbox) + (size_t)slots * cellSize;
+	if ( nodes == 0 || nodes > (SIZE_MAX / 2 - SHM_LINE) / inboxSize ) {
+		fprintf(stderr, "ShmNet: %u nodes of %u slots do not fit an address space\n", nodes, slots);
+		exit(1);
+	}
+	regionSize = SHM_LINE + nodes * inboxSize;
+
+	if ( par->SHM_KEY > 0 ) {
+		sprintf(name, "/mp1-shm-%d", par->SHM_KEY);
+	}
+	else {
+		// Private to this process
+		sprintf(name, "/mp1-shm-p%d", (int)getpid());
+	}
+
+	int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+	creator = (fd >= 0);
+	if ( !creator && errno == EEXIST ) {
+		fd = shm_open(name, O_RDWR, 0600);
+	}
+	if ( fd < 0 || (creator && ftruncate(fd, regionSize) < 0) ) {
+		perror("ShmNet shm_open");
+		exit(1);
+	}
+	// Pages are only backed once written, and a write the filesystem has no room for is a SIGBUS
+	struct statvfs vfs;
+	if ( creator && fstatvfs(fd, &vfs) == 0 && regionSize / vfs.f_frsize > vfs.f_bavail ) {
+		fprintf(stderr, "ShmNet: region %s needs %zu bytes, more than its filesystem has free\n", name, regionSize);
+		shm_unlink(name);
+		exit(1);
+	}
+	while ( !creator && (fstat(fd, &st) < 0 || (size_t)st.st_size < regionSize) && waited++ < SHM_ATTACH_WAIT ) {
+		usleep(1000);
+	}
+
+	region = (char *) mmap(NULL, regionSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if ( region == MAP_FAILED ) {
+		perror("ShmNet mmap");
+		exit(1);
+	}
+	header = (shm_header *)region;
+
+	if ( creator ) {
+		// The region comes zero-filled, which is already empty rings of free cells, so only
+		// the header is written and inboxes take memory once messages reach them
+		new (&header->ready) atomic<unsigned int>(0);
+		header->nodes = nodes;
+		header->slots = slots;
+		header->cellSize = cellSize;
+		new (&header->nextid) atomic<int>(1);
+		header->ready.store(SHM_MAGIC, memory_order_release);
+	}
+	else {
+		while ( header->ready.load(memory_order_acquire) != SHM_MAGIC && waited++ < SHM_ATTACH_WAIT ) {
+			usleep(1000);
+		}
+		if ( header->ready.load(memory_order_acquire) != SHM_MAGIC || header->nodes != nodes || header->slots != slots || header->cellSize != cellSize ) {
+			fprintf(stderr, "ShmNet: region %s is not laid out for these parameters\n", name);
+			exit(1);
+		}
+	}
+
+	// Every node of the region is a valid destination, wherever it runs
+	addNode(nodes);
+	pushed = 0;
+	popped = 0;
+	ringFull = 0;
+	pushNsec = 0;
+	popNsec = 0;
+}
+
+/**
+ * Destructor
+ */
+ShmNet::~ShmNet() {
+	munmap(region, regionSize);
+	if ( creator ) {
+		shm_unlink(name);
+	}
+}
+
+/**
+ * FUNCTION NAME: elapsed
+ *
+ * DESCRIPTION: Nanoseconds since start
+ */
+long ShmNet::elapsed(struct timespec *start) {
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	return (end.tv_sec - start->tv_sec) * 1000000000L + (end.tv_nsec - start->tv_nsec);
+}
+
+/**
+ * FUNCTION NAME: inboxOf
+ *
+ * DESCRIPTION: Ring of node id; the header takes the first SHM_LINE bytes
+ */
+shm_inbox *ShmNet::inboxOf(int id) {
+	return (shm_inbox *)(region + SHM_LINE + (size_t)(id - 1) * inboxSize);
+}
+
+/**
+ * FUNCTION NAME: cellOf
+ *
+ * DESCRIPTION: Cell that ring position pos maps to
+ */
+shm_cell *ShmNet::cellOf(shm_inbox *box, unsigned long pos) {
+	return (shm_cell *)((char *)box + sizeof(shm_inbox) + (pos & (header->slots - 1)) * header->cellSize);
+}
+
+/**
+ * FUNCTION NAME: lapOf
+ *
+ * DESCRIPTION: First position of the lap pos is in; a cell's seq is that while free, one more while full
+ */
+unsigned long ShmNet::lapOf(unsigned long pos) {
+	return pos & ~(unsigned long)(header->slots - 1);
+}
+
+/**
+ * FUNCTION NAME: push
+ *
+ * DESCRIPTION: Append a message to the ring of node dst. Safe against producers in
+ * 				other threads and processes; false if the ring is full.
+ */
+bool ShmNet::push(int dst, int from, char *data, int size) {
+	shm_inbox *box = inboxOf(dst);
+	unsigned long pos = box->head.load(memory_order_relaxed);
+	shm_cell *cell;
+
+	while ( true ) {
+		cell = cellOf(box, pos);
+		long diff = (long)cell->seq.load(memory_order_acquire) - (long)lapOf(pos);
+		if ( diff == 0 ) {
+			// Free for this lap; claim it unless another producer got there first
+			if ( box->head.compare_exchange_weak(pos, pos + 1, memory_order_relaxed) ) {
+				break;
+			}
+		}
+		else if ( diff < 0 ) {
+			// The consumer has not freed it from the previous lap
+			return false;
+		}
+		else {
+			pos = box->head.load(memory_order_relaxed);
+		}
+	}
+
+	cell->size = size;
+	cell->from = from;
+	memcpy((char *)(cell + 1), data, size);
+	cell->seq.store(lapOf(pos) + 1, memory_order_release);
+	return true;
+}
+
+/**
+ * FUNCTION NAME: pop
+ *
+ * DESCRIPTION: Take the oldest envelope off the ring of node id into em, with a payload
+ * 				from the pool, NULL if its frames did not add up; false if the ring is empty.
+ * 				Only the owner of id may call it.
+ */
+bool ShmNet::pop(int id, en_msg &em) {
+	shm_inbox *box = inboxOf(id);
+	unsigned long pos = box->tail.load(memory_order_relaxed);
+	shm_cell *cell = cellOf(box, pos);
+
+	if ( cell->seq.load(memory_order_acquire) != lapOf(pos) + 1 ) {
+		return false;
+	}
+
+	em = envelope(cell->from, id, rawPayload((char *)(cell + 1), cell->size));
+
+	// Hand the cell back to producers for the next lap
+	cell->seq.store(lapOf(pos) + header->slots, memory_order_release);
+	box->tail.store(pos + 1, memory_order_relaxed);
+	return true;
+}
+
+/**
+ * FUNCTION NAME: ENinit
+ *
+ * DESCRIPTION: Claim the next node id of the region, shared by every attached process
+ */
+void *ShmNet::ENinit(Address *myaddr, short port) {
+	int id = header->nextid.fetch_add(1);
+	if ( id > (int)header->nodes ) {
+		fprintf(stderr, "ShmNet: region %s has room for %u nodes\n", name, header->nodes);
+		exit(1);
+	}
+
+	*(int *)(myaddr->addr) = id;
+	*(short *)(&myaddr->addr[4]) = 0;
+	if ( id >= emulnet.nextid ) {
+		emulnet.nextid = id + 1;
+	}
+	addNode(id);
+	local.push_back(id);
+	return myaddr;
+}
+
+/**
+ * FUNCTION NAME: ENflush
+ *
+ * DESCRIPTION: Push the messages queued this tick onto their receivers' rings,
+ * 				senders from the highest id down as in EmulNet. When receivers is given,
+ * 				the local rings are popped and the nodes that got messages appended.
+ *
+ * RETURNS:
+ * number of messages pushed
+ */
+int ShmNet::ENflush(vector< pair<int, int> > *receivers) {
+	struct timespec start;
+	int i, dst, delivered = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for ( i = (int)emulnet.outbox.size() - 1; i > 0; i-- ) {
+		if ( par->COALESCE ) {
+			coalesce(i);
+		}
+		vector<en_msg> &out = emulnet.outbox[i];
+		for ( unsigned int j = 0; j < out.size(); j++ ) {
+			en_msg &em = out[j];
+			dst = *(int *)(em.to.addr);
+			if ( push(dst, i, (char *)(em.payload + 1), em.payload->size) ) {
+				accountSent(i, em.payload);
+				delivered++;
+			}
+			else {
+				ringFull++;
+			}
+			unref(em.payload);
+		}
+		out.clear();
+	}
+	pushNsec += elapsed(&start);
+	pushed += delivered;
+
+	// Wake the nodes of this process whose rings have messages, sent from here or by another
+	// process; what lands after this is found by the next flush
+	if ( receivers != NULL ) {
+		ENtick();
+	}
+	reportArrivals(receivers);
+
+	return delivered;
+}
+
+/**
+ * FUNCTION NAME: ENtick
+ *
+ * DESCRIPTION: Move everything waiting on the rings of this process's nodes to their inboxes
+ */
+void ShmNet::ENtick() {
+	struct timespec start;
+	en_msg em;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for ( unsigned int k = 0; k < local.size(); k++ ) {
+		unsigned int queued = emulnet.inbox[local[k]].size();
+		while ( pop(local[k], em) ) {
+			if ( em.payload != NULL ) {
+				emulnet.inbox[local[k]].push_back(em);
+			}
+			popped++;
+		}
+		if ( emulnet.inbox[local[k]].size() > queued ) {
+			arrivals.push_back(local[k]);
+		}
+	}
+	popNsec += elapsed(&start);
+}
+
+/**
+ * FUNCTION NAME: ENcleanup
+ *
+ * DESCRIPTION: Collect messages still on the rings, write the EmulNet summary and
+ * 				add the ring counters to msgcount.log
+ */
+int ShmNet::ENcleanup() {
+	ENtick();
+	EmulNet::ENcleanup();
+
+	FILE* file = fopen((par->LOG_PREFIX + MSGCOUNT_LOG).c_str(), "a");
+	fprintf(file, "shm push %8ld  time %9.3f ms  per message %7.3f us  ring full %ld\n",
+			pushed, pushNsec / 1e6, pushed ? pushNsec / 1e3 / pushed : 0.0, ringFull);
+	fprintf(file, "shm pop  %8ld  time %9.3f ms  per message %7.3f us\n",
+			popped, popNsec / 1e6, popped ? popNsec / 1e3 / popped : 0.0);
+	fclose(file);
+	return 0;
+}
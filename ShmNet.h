@@ -0,0 +1,110 @@
+/**********************************
+ * FILE NAME: ShmNet.h
+ *
+ * DESCRIPTION: Shared-memory transport behind the EmulNet interface
+ **********************************/
+
+#ifndef _SHMNET_H_
+#define _SHMNET_H_
+
+#include "stdincludes.h"
+#include "EmulNet.h"
+#include <atomic>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+
+/*
+ * Macros
+ */
+#define SHM_MAGIC 0x4d503153
+// cells are padded to this, and ring indices kept on lines of their own
+#define SHM_LINE 64
+// how long an attaching process waits for the creator to lay out the region, in ms
+#define SHM_ATTACH_WAIT 5000
+// largest ring a node may have
+#define SHM_MAX_SLOTS (1u << 24)
+
+/**
+ * Struct Name: shm_header
+ *
+ * DESCRIPTION: Start of the region: its geometry and the next node id to hand out.
+ * 				ready is set to SHM_MAGIC once the creator has laid out every inbox.
+ */
+typedef struct shm_header {
+	atomic<unsigned int> ready;
+	unsigned int nodes;
+	unsigned int slots;
+	unsigned int cellSize;
+	atomic<int> nextid;
+}shm_header;
+
+/**
+ * Struct Name: shm_inbox
+ *
+ * DESCRIPTION: Bounded MPSC ring of one node, followed by its cells. Producers claim
+ * 				a position by advancing head; the owner alone advances tail.
+ */
+typedef struct shm_inbox {
+	alignas(SHM_LINE) atomic<unsigned long> head;
+	alignas(SHM_LINE) atomic<unsigned long> tail;
+}shm_inbox;
+
+/**
+ * Struct Name: shm_cell
+ *
+ * DESCRIPTION: One slot of a ring, followed by up to MAX_MSG_SIZE bytes of payload.
+ * 				seq equal to the first position of a lap means free for that lap, one
+ * 				more full; zero is free for the first lap, so fresh cells need no setup.
+ */
+typedef struct shm_cell {
+	atomic<unsigned long> seq;
+	int size;
+	int from;
+}shm_cell;
+
+/**
+ * CLASS NAME: ShmNet
+ *
+ * DESCRIPTION: Carries messages through a POSIX shared-memory region holding one
+ * 				lock-free bounded MPSC inbox per node, so nodes may live in separate
+ * 				processes that attach the same SHM_KEY. The region holds offsets only.
+ * 				Sends queue in the EmulNet outboxes and are pushed onto the receivers'
+ * 				rings at ENflush; ENtick pops the rings of this process's nodes into
+ * 				the inboxes ENrecv hands out. A message finding its ring full is dropped.
+ * 				The latency model does not apply.
+ */
+class ShmNet : public EmulNet
+{
+private:
+	char name[64];
+	bool creator;
+	char *region;
+	size_t regionSize;
+	shm_header *header;
+	size_t inboxSize;
+	// Nodes initialized by this process
+	vector<int> local;
+	// Ring operations done, messages dropped on a full ring, and time spent in each direction
+	long pushed;
+	long popped;
+	long ringFull;
+	long pushNsec;
+	long popNsec;
+	shm_inbox *inboxOf(int id);
+	shm_cell *cellOf(shm_inbox *box, unsigned long pos);
+	unsigned long lapOf(unsigned long pos);
+	bool push(int dst, int from, char *data, int size);
+	bool pop(int id, en_msg &em);
+	static long elapsed(struct timespec *start);
+public:
+	ShmNet(Params *p);
+	virtual ~ShmNet();
+	void *ENinit(Address *myaddr, short port);
+	void ENtick();
+	int ENflush(vector< pair<int, int> > *receivers = NULL);
+	int ENcleanup();
+};
+
+#endif /* _SHMNET_H_ */
@@ -0,0 +1,147 @@
+/**********************************
+ * FILE NAME: TimerWheel.h
+ *
+ * DESCRIPTION: Hierarchical timing wheel holding items until a given tick
+ **********************************/
+
+#ifndef _TIMERWHEEL_H_
+#define _TIMERWHEEL_H_
+
+#include "stdincludes.h"
+
+/*
+ * Macros
+ */
+// each level has 2^WHEEL_BITS slots, so WHEEL_LEVELS levels cover 2^32 ticks ahead
+#define WHEEL_BITS 8
+#define WHEEL_SLOTS (1 << WHEEL_BITS)
+#define WHEEL_MASK (WHEEL_SLOTS - 1)
+#define WHEEL_LEVELS 4
+
+/**
+ * CLASS NAME: TimerWheel
+ *
+ * DESCRIPTION: Items scheduled for an absolute tick. Level 0 has one slot per tick
+ * 				for the next WHEEL_SLOTS ticks; a slot of level l spans WHEEL_SLOTS^l
+ * 				ticks and is moved down a level when the wheel below wraps around.
+ * 				schedule is O(1); advance is O(1) per tick plus the items fired or
+ * 				moved down, each item moving at most WHEEL_LEVELS - 1 times.
+ */
+template <class T>
+class TimerWheel {
+private:
+	struct Entry {
+		long when;
+		T item;
+	};
+	vector<Entry> slots[WHEEL_LEVELS][WHEEL_SLOTS];
+	// scheduled for a tick already reached, fired by the next advance
+	vector<Entry> overdue;
+	// last tick advanced to
+	long now;
+	long count;
+
+	void place(const Entry &e) {
+		long diff = e.when - now;
+		int level = 0;
+		while ( level < WHEEL_LEVELS - 1 && diff >= (1L << (WHEEL_BITS * (level + 1))) ) {
+			level++;
+		}
+		slots[level][(e.when >> (WHEEL_BITS * level)) & WHEEL_MASK].push_back(e);
+	}
+
+	// Move the slot of level that the current tick points at down to the levels below
+	void cascade(int level) {
+		vector<Entry> moved;
+		moved.swap(slots[level][(now >> (WHEEL_BITS * level)) & WHEEL_MASK]);
+		for ( unsigned int i = 0; i < moved.size(); i++ ) {
+			place(moved[i]);
+		}
+	}
+
+public:
+	TimerWheel(long start = 0): now(start), count(0) {}
+
+	/**
+	 * FUNCTION NAME: schedule
+	 *
+	 * DESCRIPTION: Hold item until tick when
+	 */
+	void schedule(long when, T item) {
+		Entry e;
+		e.when = when;
+		e.item = item;
+		count++;
+		if ( when <= now ) {
+			overdue.push_back(e);
+		}
+		else {
+			place(e);
+		}
+	}
+
+	/**
+	 * FUNCTION NAME: advance
+	 *
+	 * DESCRIPTION: Move the wheel to tick to, calling fire(item) for every item due
+	 * 				by then, earlier ticks first
+	 */
+	template <class F>
+	void advance(long to, F fire) {
+		for ( unsigned int i = 0; i < overdue.size(); i++ ) {
+			count--;
+			fire(overdue[i].item);
+		}
+		overdue.clear();
+
+		while ( now < to ) {
+			now++;
+			// On wrap-around of a level, pull the next slot of the level above down
+			for ( int level = 1; level < WHEEL_LEVELS; level++ ) {
+				if ( (now >> (WHEEL_BITS * (level - 1))) & WHEEL_MASK ) {
+					break;
+				}
+				cascade(level);
+			}
+
+			vector<Entry> &slot = slots[0][now & WHEEL_MASK];
+			for ( unsigned int i = 0; i < slot.size(); i++ ) {
+				count--;
+				fire(slot[i].item);
+			}
+			slot.clear();
+		}
+	}
+
+	/**
+	 * FUNCTION NAME: drain
+	 *
+	 * DESCRIPTION: Call fire(item) for every item still held, in no particular order, and empty the wheel
+	 */
+	template <class F>
+	void drain(F fire) {
+		for ( unsigned int i = 0; i < overdue.size(); i++ ) {
+			fire(overdue[i].item);
+		}
+		overdue.clear();
+		for ( int level = 0; level < WHEEL_LEVELS; level++ ) {
+			for ( int s = 0; s < WHEEL_SLOTS; s++ ) {
+				for ( unsigned int i = 0; i < slots[level][s].size(); i++ ) {
+					fire(slots[level][s][i].item);
+				}
+				slots[level][s].clear();
+			}
+		}
+		count = 0;
+	}
+
+	long size() {
+		return count;
+	}
+
+	long getNow() {
+		return now;
+	}
+};
+
+#endif /* _TIMERWHEEL_H_ */
@@ -0,0 +1,273 @@
+/**********************************
+ * FILE NAME: UdpNet.cpp
+ *
+ * DESCRIPTION: UDP loopback transport definition
+ **********************************/
+
+#include "UdpNet.h"
+
+/**
+ * Constructor
+ */
+UdpNet::UdpNet(Params *p): EmulNet(p) {
+	epfd = epoll_create1(0);
+	if ( epfd < 0 ) {
+		perror("UdpNet epoll_create1");
+		exit(1);
+	}
+	// Node ids start at 1
+	sockets.push_back(-1);
+	addrs.resize(1);
+	rxbuf.resize(UDP_BATCH * par->MAX_MSG_SIZE);
+	memset(&sendCalls, 0, sizeof(sendCalls));
+	memset(&recvCalls, 0, sizeof(recvCalls));
+	memset(&pollCalls, 0, sizeof(pollCalls));
+	sendErrors = 0;
+	badDatagrams = 0;
+}
+
+/**
+ * Destructor
+ */
+UdpNet::~UdpNet() {
+	for ( unsigned int i = 0; i < sockets.size(); i++ ) {
+		if ( sockets[i] >= 0 ) {
+			close(sockets[i]);
+		}
+	}
+	close(epfd);
+}
+
+/**
+ * FUNCTION NAME: elapsed
+ *
+ * DESCRIPTION: Nanoseconds since start
+ */
+long UdpNet::elapsed(struct timespec *start) {
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	return (end.tv_sec - start->tv_sec) * 1000000000L + (end.tv_nsec - start->tv_nsec);
+}
+
+/**
+ * FUNCTION NAME: ENinit
+ *
+ * DESCRIPTION: Give the node an id as EmulNet does, and a non-blocking socket bound to
+ * 				a port of its own on 127.0.0.1, watched by epoll
+ */
+void *UdpNet::ENinit(Address *myaddr, short port) {
+	struct sockaddr_in sa;
+	socklen_t len = sizeof(sa);
+	struct epoll_event ev;
+	int rcvbuf = UDP_RCVBUF;
+
+	EmulNet::ENinit(myaddr, port);
+	int id = *(int *)(myaddr->addr);
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sin_family = AF_INET;
+	sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	// Any free port; the table below is how other nodes find it
+	sa.sin_port = 0;
+
+	int fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+	if ( fd < 0 || bind(fd, (struct sockaddr *)&sa, sizeof(sa)) < 0 || getsockname(fd, (struct sockaddr *)&sa, &len) < 0 ) {
+		perror("UdpNet socket");
+		exit(1);
+	}
+	setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+	ev.events = EPOLLIN;
+	ev.data.u32 = id;
+	if ( epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) < 0 ) {
+		perror("UdpNet epoll_ctl");
+		exit(1);
+	}
+
+	sockets.resize(id + 1, -1);
+	addrs.resize(id + 1);
+	sockets[id] = fd;
+	addrs[id] = sa;
+	portToId[ntohs(sa.sin_port)] = id;
+
+	return myaddr;
+}
+
+/**
+ * FUNCTION NAME: ENflush
+ *
+ * DESCRIPTION: Send the messages queued this tick, one sendmmsg per UDP_BATCH datagrams
+ * 				of a sender. Senders go from the highest id down as in EmulNet. A datagram
+ * 				the kernel refuses is counted in sendErrors and dropped. When receivers is
+ * 				given, the sockets are drained and the nodes that got datagrams appended.
+ *
+ * RETURNS:
+ * number of datagrams sent
+ */
+int UdpNet::ENflush(vector< pair<int, int> > *receivers) {
+	struct mmsghdr msgs[UDP_BATCH];
+	struct iovec iov[UDP_BATCH];
+	struct timespec start;
+	int i, k, n, dst, sent, delivered = 0;
+
+	for ( i = (int)emulnet.outbox.size() - 1; i > 0; i-- ) {
+		if ( par->COALESCE ) {
+			coalesce(i);
+		}
+		vector<en_msg> &out = emulnet.outbox[i];
+		unsigned int next = 0;
+
+		while ( next < out.size() ) {
+			n = min((int)(out.size() - next), UDP_BATCH);
+			memset(msgs, 0, n * sizeof(struct mmsghdr));
+			for ( k = 0; k < n; k++ ) {
+				en_msg &em = out[next + k];
+				dst = *(int *)(em.to.addr);
+				iov[k].iov_base = (char *)(em.payload + 1);
+				iov[k].iov_len = em.payload->size;
+				msgs[k].msg_hdr.msg_name = &addrs[dst];
+				msgs[k].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+				msgs[k].msg_hdr.msg_iov = &iov[k];
+				msgs[k].msg_hdr.msg_iovlen = 1;
+			}
+
+			clock_gettime(CLOCK_MONOTONIC, &start);
+			sent = sendmmsg(sockets[i], msgs, n, 0);
+			sendCalls.nsec += elapsed(&start);
+			sendCalls.calls++;
+
+			if ( sent <= 0 ) {
+				// The first datagram of the batch failed; skip it and go on with the rest
+				sendErrors++;
+				next++;
+				continue;
+			}
+			sendCalls.msgs += sent;
+
+			for ( k = 0; k < sent; k++ ) {
+				en_msg &em = out[next + k];
+				dst = *(int *)(em.to.addr);
+				accountSent(i, em.payload);
+				delivered++;
+			}
+			next += sent;
+		}
+
+		for ( unsigned int j = 0; j < out.size(); j++ ) {
+			unref(out[j].payload);
+		}
+		out.clear();
+	}
+
+	// Loopback normally queues a datagram before sendmmsg returns, but only what epoll
+	// reports is certain; anything later is found by the next flush and woken then
+	if ( receivers != NULL ) {
+		ENtick();
+	}
+	reportArrivals(receivers);
+
+	return delivered;
+}
+
+/**
+ * FUNCTION NAME: ENtick
+ *
+ * DESCRIPTION: Move every datagram waiting in a socket to its node's inbox
+ */
+void UdpNet::ENtick() {
+	struct epoll_event events[UDP_BATCH];
+	struct timespec start;
+	int k, n;
+
+	do {
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		n = epoll_wait(epfd, events, UDP_BATCH, 0);
+		pollCalls.nsec += elapsed(&start);
+		pollCalls.calls++;
+		if ( n > 0 ) {
+			pollCalls.msgs += n;
+		}
+
+		for ( k = 0; k < n; k++ ) {
+			drain(events[k].data.u32);
+		}
+	} while ( n == UDP_BATCH );
+}
+
+/**
+ * FUNCTION NAME: drain
+ *
+ * DESCRIPTION: Read the socket of node id until it would block, UDP_BATCH datagrams
+ * 				per recvmmsg, copying each into a payload from the pool. A datagram
+ * 				carries the frames of one envelope.
+ */
+void UdpNet::drain(int id) {
+	struct mmsghdr msgs[UDP_BATCH];
+	struct iovec iov[UDP_BATCH];
+	struct sockaddr_in from[UDP_BATCH];
+	struct timespec start;
+	int k, n;
+
+	if ( id <= 0 || id >= (int)sockets.size() ) {
+		return;
+	}
+
+	unsigned int queued = emulnet.inbox[id].size();
+	do {
+		memset(msgs, 0, sizeof(msgs));
+		for ( k = 0; k < UDP_BATCH; k++ ) {
+			iov[k].iov_base = &rxbuf[k * par->MAX_MSG_SIZE];
+			iov[k].iov_len = par->MAX_MSG_SIZE;
+			msgs[k].msg_hdr.msg_name = &from[k];
+			msgs[k].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+			msgs[k].msg_hdr.msg_iov = &iov[k];
+			msgs[k].msg_hdr.msg_iovlen = 1;
+		}
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		n = recvmmsg(sockets[id], msgs, UDP_BATCH, MSG_DONTWAIT, NULL);
+		recvCalls.nsec += elapsed(&start);
+		recvCalls.calls++;
+		if ( n <= 0 ) {
+			break;
+		}
+		recvCalls.msgs += n;
+
+		for ( k = 0; k < n; k++ ) {
+			auto src = portToId.find(ntohs(from[k].sin_port));
+			en_payload *payload = rawPayload((char *)iov[k].iov_base, msgs[k].msg_len);
+			if ( payload == NULL ) {
+				badDatagrams++;
+				continue;
+			}
+			emulnet.inbox[id].push_back(envelope((src != portToId.end()) ? src->second : 0, id, payload));
+		}
+	} while ( n == UDP_BATCH );
+
+	if ( emulnet.inbox[id].size() > queued ) {
+		arrivals.push_back(id);
+	}
+}
+
+/**
+ * FUNCTION NAME: ENcleanup
+ *
+ * DESCRIPTION: Collect datagrams still in flight, write the EmulNet summary and
+ * 				add the system call counters to msgcount.log
+ */
+int UdpNet::ENcleanup() {
+	ENtick();
+	EmulNet::ENcleanup();
+
+	FILE* file = fopen((par->LOG_PREFIX + MSGCOUNT_LOG).c_str(), "a");
+	udp_calls *calls[] = { &sendCalls, &recvCalls, &pollCalls };
+	const char *names[] = { "sendmmsg", "recvmmsg", "epoll_wait" };
+	for ( int i = 0; i < 3; i++ ) {
+		fprintf(file, "udp %-10s calls %8ld  items %8ld  time %9.3f ms  per call %7.3f us\n",
+				names[i], calls[i]->calls, calls[i]->msgs, calls[i]->nsec / 1e6,
+				calls[i]->calls ? calls[i]->nsec / 1e3 / calls[i]->calls : 0.0);
+	}
+	fprintf(file, "udp send errors %ld  malformed datagrams %ld\n", sendErrors, badDatagrams);
+	fclose(file);
+	return 0;
+}
@@ -0,0 +1,74 @@
+/**********************************
+ * FILE NAME: UdpNet.h
+ *
+ * DESCRIPTION: UDP loopback transport behind the EmulNet interface
+ **********************************/
+
+#ifndef _UDPNET_H_
+#define _UDPNET_H_
+
+#include "stdincludes.h"
+#include "EmulNet.h"
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/*
+ * Macros
+ */
+// datagrams moved per sendmmsg/recvmmsg call
+#define UDP_BATCH 64
+// receive buffer asked for on every socket, so a busy tick does not overflow it
+#define UDP_RCVBUF (1 << 20)
+
+/**
+ * Struct Name: udp_calls
+ *
+ * DESCRIPTION: Calls made to one system call, the datagrams they moved and the time spent in them
+ */
+typedef struct udp_calls {
+	long calls;
+	long msgs;
+	long nsec;
+}udp_calls;
+
+/**
+ * CLASS NAME: UdpNet
+ *
+ * DESCRIPTION: Carries messages in UDP datagrams on 127.0.0.1, one non-blocking socket
+ * 				and port per node. Sends queue in the EmulNet outboxes as before and go
+ * 				out in one sendmmsg batch per sender at ENflush; ENtick asks epoll which
+ * 				sockets have data and drains them with recvmmsg into the inboxes that
+ * 				ENrecv hands out. The latency model does not apply; the kernel's own
+ * 				delays are what is being measured.
+ */
+class UdpNet : public EmulNet
+{
+private:
+	int epfd;
+	// Socket and bound address of each node, indexed by node id
+	vector<int> sockets;
+	vector<struct sockaddr_in> addrs;
+	// Node id of each bound port, to fill in en_msg::from
+	unordered_map<unsigned short, int> portToId;
+	// recvmmsg lands here, UDP_BATCH slots of MAX_MSG_SIZE bytes
+	vector<char> rxbuf;
+	udp_calls sendCalls;
+	udp_calls recvCalls;
+	udp_calls pollCalls;
+	long sendErrors;
+	// Datagrams whose frames did not add up, dropped
+	long badDatagrams;
+	void drain(int id);
+	static long elapsed(struct timespec *start);
+public:
+	UdpNet(Params *p);
+	virtual ~UdpNet();
+	void *ENinit(Address *myaddr, short port);
+	void ENtick();
+	int ENflush(vector< pair<int, int> > *receivers = NULL);
+	int ENcleanup();
+};
+
+#endif /* _UDPNET_H_ */
@@ -0,0 +1,191 @@
+/**********************************
+ * FILE NAME: Wire.cpp
+ *
+ * DESCRIPTION: Definition of the portable message encoding helpers
+ **********************************/
+
+#include "Wire.h"
+
+/**
+ * Constructor
+ */
+WireWriter::WireWriter(char *buf, int capacity): buf(buf), capacity(capacity), pos(0), overflowed(false) {}
+
+/**
+ * FUNCTION NAME: putByte
+ *
+ * DESCRIPTION: Append one byte
+ */
+void WireWriter::putByte(unsigned char value) {
+	if ( pos >= capacity ) {
+		overflowed = true;
+		return;
+	}
+	buf[pos++] = (char)value;
+}
+
+/**
+ * FUNCTION NAME: putVarint
+ *
+ * DESCRIPTION: Append an unsigned integer, seven bits per byte, least significant first
+ */
+void WireWriter::putVarint(unsigned long long value) {
+	while ( value >= 0x80 ) {
+		putByte((unsigned char)(value | 0x80));
+		value >>= 7;
+	}
+	putByte((unsigned char)value);
+}
+
+/**
+ * FUNCTION NAME: putSVarint
+ *
+ * DESCRIPTION: Append a signed integer, zigzag encoded so small magnitudes stay short
+ */
+void WireWriter::putSVarint(long long value) {
+	putVarint(((unsigned long long)value << 1) ^ (unsigned long long)(value >> 63));
+}
+
+/**
+ * FUNCTION NAME: putAddress
+ *
+ * DESCRIPTION: Append a node address as its id and port
+ */
+void WireWriter::putAddress(Address *addr) {
+	int id;
+	short port;
+	memcpy(&id, &addr->addr[0], sizeof(int));
+	memcpy(&port, &addr->addr[4], sizeof(short));
+	putSVarint(id);
+	putSVarint(port);
+}
+
+/**
+ * FUNCTION NAME: size
+ *
+ * DESCRIPTION: Bytes written so far
+ */
+int WireWriter::size() {
+	return pos;
+}
+
+/**
+ * FUNCTION NAME: overflow
+ *
+ * DESCRIPTION: Whether a write did not fit in the buffer
+ */
+bool WireWriter::overflow() {
+	return overflowed;
+}
+
+/**
+ * FUNCTION NAME: varintSize
+ *
+ * DESCRIPTION: Bytes putVarint would use for value
+ */
+int WireWriter::varintSize(unsigned long long value) {
+	int n = 1;
+	while ( value >= 0x80 ) {
+		value >>= 7;
+		n++;
+	}
+	return n;
+}
+
+/**
+ * FUNCTION NAME: svarintSize
+ *
+ * DESCRIPTION: Bytes putSVarint would use for value
+ */
+int WireWriter::svarintSize(long long value) {
+	return varintSize(((unsigned long long)value << 1) ^ (unsigned long long)(value >> 63));
+}
+
+/**
+ * FUNCTION NAME: addressSize
+ *
+ * DESCRIPTION: Bytes putAddress would use for addr
+ */
+int WireWriter::addressSize(Address *addr) {
+	int id;
+	short port;
+	memcpy(&id, &addr->addr[0], sizeof(int));
+	memcpy(&port, &addr->addr[4], sizeof(short));
+	return svarintSize(id) + svarintSize(port);
+}
+
+/**
+ * Constructor
+ */
+WireReader::WireReader(const char *buf, int size): buf(buf), size(size), pos(0), failed(false) {}
+
+/**
+ * FUNCTION NAME: getByte
+ *
+ * DESCRIPTION: Read one byte
+ */
+unsigned char WireReader::getByte() {
+	if ( pos >= size ) {
+		failed = true;
+		return 0;
+	}
+	return (unsigned char)buf[pos++];
+}
+
+/**
+ * FUNCTION NAME: getVarint
+ *
+ * DESCRIPTION: Read an unsigned integer written by putVarint
+ */
+unsigned long long WireReader::getVarint() {
+	unsigned long long value = 0;
+	for ( int shift = 0; shift < 7 * WIRE_MAX_VARINT; shift += 7 ) {
+		unsigned char byte = getByte();
+		value |= (unsigned long long)(byte & 0x7f) << shift;
+		if ( !(byte & 0x80) ) {
+			return value;
+		}
+	}
+	failed = true;
+	return 0;
+}
+
+/**
+ * FUNCTION NAME: getSVarint
+ *
+ * DESCRIPTION: Read a signed integer written by putSVarint
+ */
+long long WireReader::getSVarint() {
+	unsigned long long value = getVarint();
+	return (long long)(value >> 1) ^ -(long long)(value & 1);
+}
+
+/**
+ * FUNCTION NAME: getAddress
+ *
+ * DESCRIPTION: Read a node address written by putAddress
+ */
+void WireReader::getAddress(Address *addr) {
+	int id = (int)getSVarint();
+	short port = (short)getSVarint();
+	memcpy(&addr->addr[0], &id, sizeof(int));
+	memcpy(&addr->addr[4], &port, sizeof(short));
+}
+
+/**
+ * FUNCTION NAME: remaining
+ *
+ * DESCRIPTION: Bytes left to read
+ */
+int WireReader::remaining() {
+	return size - pos;
+}
+
+/**
+ * FUNCTION NAME: ok
+ *
+ * DESCRIPTION: Whether every read so far was within the input
+ */
+bool WireReader::ok() {
+	return !failed;
+}
@@ -0,0 +1,68 @@
+/**********************************
+ * FILE NAME: Wire.h
+ *
+ * DESCRIPTION: Header file of the portable message encoding helpers
+ **********************************/
+
+#ifndef _WIRE_H_
+#define _WIRE_H_
+
+#include "stdincludes.h"
+#include "Member.h"
+
+/*
+ * Macros
+ */
+// version byte carried after the message type, bumped on incompatible changes
+#define WIRE_VERSION 3
+// longest encoding of a 64 bit varint
+#define WIRE_MAX_VARINT 10
+
+/**
+ * CLASS NAME: WireWriter
+ *
+ * DESCRIPTION: Appends fields to a caller provided buffer.
+ * 				Integers are LEB128 varints, signed ones zigzag encoded first, so the
+ * 				encoding does not depend on host byte order or type sizes.
+ */
+class WireWriter {
+private:
+	char *buf;
+	int capacity;
+	int pos;
+	bool overflowed;
+public:
+	WireWriter(char *buf, int capacity);
+	void putByte(unsigned char value);
+	void putVarint(unsigned long long value);
+	void putSVarint(long long value);
+	void putAddress(Address *addr);
+	int size();
+	bool overflow();
+	static int varintSize(unsigned long long value);
+	static int svarintSize(long long value);
+	static int addressSize(Address *addr);
+};
+
+/**
+ * CLASS NAME: WireReader
+ *
+ * DESCRIPTION: Reads fields written by WireWriter, flagging truncated input
+ */
+class WireReader {
+private:
+	const char *buf;
+	int size;
+	int pos;
+	bool failed;
+public:
+	WireReader(const char *buf, int size);
+	unsigned char getByte();
+	unsigned long long getVarint();
+	long long getSVarint();
+	void getAddress(Address *addr);
+	int remaining();
+	bool ok();
+};
+
+#endif /* _WIRE_H_ */
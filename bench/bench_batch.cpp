@@ -0,0 +1,132 @@
+/**********************************
+ * FILE NAME: bench_batch.cpp
+ *
+ * DESCRIPTION: GOSSIP_BATCH against the per-entry merge. Two nodes, one with
+ * 				the batch off and one with it on, receive the same membership
+ * 				lists every tick: the first calls addMember per entry, as
+ * 				receiveMembershipList does by default, the second batchMember per
+ * 				entry and applyMergeBatch once the tick's lists are read. After
+ * 				every tick both tables must hold the same members with the same
+ * 				heartbeat and timestamp, and the same nnb; a mismatch fails the run.
+ * 				Both nodes log to bench/batch_dbg.log, which is timed with them.
+ * 				Run from the top directory: bench/bench_batch [testcase]
+ **********************************/
+
+#include "MP1Node.h"
+#include <chrono>
+
+#define BENCH_TICKS 300
+// ticks a list lags behind the members' own heartbeats, at most
+#define BENCH_LAG 8
+// percent of the members a list carries, and of them failing during the run
+#define BENCH_CARRIED 90
+#define BENCH_FAILED 5
+
+static double now() {
+	return chrono::duration<double, micro>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * FUNCTION NAME: snapshot
+ *
+ * DESCRIPTION: Members of a node's table in key order, with heartbeat and timestamp
+ */
+static void snapshot(MP1Node *node, vector< pair<long long, pair<long, long> > > &out) {
+	MemberTable *table = node->getMembers();
+	out.clear();
+	for ( int slot = 0; slot < table->size(); slot++ ) {
+		out.push_back(make_pair(MemberTable::key(table->ids[slot], table->ports[slot]),
+				make_pair(table->heartbeats[slot], (long)table->timestamps[slot])));
+	}
+	sort(out.begin(), out.end());
+}
+
+int main(int argc, char *argv[]) {
+	char *testcase = (char *)(argc > 1 ? argv[1] : "testcases/singlefailure.conf");
+	Params perEntry, batched;
+	perEntry.setparams(testcase);
+	batched.setparams(testcase);
+	perEntry.setparam("GOSSIP_BATCH", 0);
+	batched.setparam("GOSSIP_BATCH", 1);
+	perEntry.LOG_PREFIX = "bench/batch_";
+	Log log(&perEntry);
+	vector< pair<long long, pair<long, long> > > expect, got;
+	long mismatches = 0;
+
+	printf("%8s %12s %14s %14s %14s %8s\n", "members", "lists/tick", "entries/tick", "entry us/tick", "batch us/tick",
+			"speedup");
+	// a group gossiping to six peers, a small one gossiping to all, and a large one
+	int sizes[][2] = { { 200, 6 }, { 100, 99 }, { 1000, 6 } };
+	for ( auto &size : sizes ) {
+		int n = size[0];
+		int lists = size[1];
+		unsigned int seed = 1;
+
+		Address addr("1:0");
+		Member memberA, memberB;
+		MP1Node *a = new MP1Node(&memberA, &perEntry, NULL, &log, &addr);
+		MP1Node *b = new MP1Node(&memberB, &batched, NULL, &log, &addr);
+		a->initThisNode(&addr);
+		b->initThisNode(&addr);
+
+		// Member i + 2 starts its heartbeat at start[i] and stops at stop[i] if it fails
+		vector<long> start(n), stop(n);
+		for ( int i = 0; i < n; i++ ) {
+			start[i] = rand_r(&seed) % 20;
+			stop[i] = (int)(rand_r(&seed) % 100) < BENCH_FAILED ? rand_r(&seed) % BENCH_TICKS : LONG_MAX;
+		}
+
+		vector<int> ids;
+		vector<long> heartbeats;
+		double entryTime = 0;
+		double batchTime = 0;
+		long entries = 0;
+		for ( long tick = 1; tick <= BENCH_TICKS; tick++ ) {
+			perEntry.globaltime = tick;
+			batched.globaltime = tick;
+			memberA.heartbeat = tick;
+			memberB.heartbeat = tick;
+
+			ids.clear();
+			heartbeats.clear();
+			for ( int l = 0; l < lists; l++ ) {
+				for ( int i = 0; i < n; i++ ) {
+					if ( tick <= start[i] || (int)(rand_r(&seed) % 100) >= BENCH_CARRIED ) {
+						continue;
+					}
+					long heartbeat = min(tick, stop[i]) - start[i] - rand_r(&seed) % BENCH_LAG;
+					ids.push_back(i + 2);
+					heartbeats.push_back(max(0L, heartbeat));
+				}
+			}
+			entries += ids.size();
+
+			double begin = now();
+			for ( unsigned int e = 0; e < ids.size(); e++ ) {
+				a->addMember(ids[e], 0, heartbeats[e]);
+			}
+			entryTime += now() - begin;
+
+			begin = now();
+			for ( unsigned int e = 0; e < ids.size(); e++ ) {
+				b->batchMember(ids[e], 0, heartbeats[e]);
+			}
+			b->applyMergeBatch();
+			batchTime += now() - begin;
+
+			snapshot(a, expect);
+			snapshot(b, got);
+			if ( expect != got || memberA.nnb != memberB.nnb ) {
+				mismatches++;
+			}
+		}
+
+		printf("%8d %12d %14ld %14.1f %14.1f %7.2fx\n", n, lists, entries / BENCH_TICKS, entryTime / BENCH_TICKS,
+				batchTime / BENCH_TICKS, entryTime / batchTime);
+		delete a;
+		delete b;
+	}
+
+	printf("batch check: %d ticks, %ld mismatches\n", BENCH_TICKS * (int)(sizeof(sizes) / sizeof(sizes[0])), mismatches);
+	return mismatches != 0;
+}
@@ -0,0 +1,101 @@
+/**********************************
+ * FILE NAME: bench_emulnet.cpp
+ *
+ * DESCRIPTION: Receive cost of EmulNet as the group grows. Every node sends
+ * 				BENCH_FANOUT messages a tick to random peers; what is timed is ENrecv
+ * 				of every node after ENflush, which should stay flat per message
+ * 				however many nodes, and so messages, the network holds. The scan
+ * 				column is the search ENrecv used to make, every node walking the
+ * 				whole buffer for messages addressed to it, over the same traffic.
+ * 				Run from the top directory: bench/bench_emulnet [testcase]
+ **********************************/
+
+#include "EmulNet.h"
+#include <chrono>
+
+#define BENCH_FANOUT 4
+#define BENCH_MSG_SIZE 100
+#define BENCH_TICKS 50
+// ticks the buffer scan is timed over; it is too slow for more at the larger sizes
+#define BENCH_SCAN_TICKS 2
+
+static long received;
+
+static double now() {
+	return chrono::duration<double, micro>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * FUNCTION NAME: consume
+ *
+ * DESCRIPTION: Stands in for the node's queue: hand the message straight back
+ */
+static int consume(void *env, char *data, int size) {
+	((EmulNet *)env)->ENrelease(data);
+	received++;
+	return 0;
+}
+
+int main(int argc, char *argv[]) {
+	char msg[BENCH_MSG_SIZE];
+	unsigned int seed = 1;
+	Params par;
+
+	par.setparams((char *)(argc > 1 ? argv[1] : "testcases/singlefailure.conf"));
+	memset(msg, 'x', sizeof(msg));
+
+	printf("%8s %12s %14s %14s %14s\n", "nodes", "in flight", "recv us/tick", "ns/message", "scan us/tick");
+	int sizes[] = { 10, 100, 1000, 5000 };
+	for ( int n : sizes ) {
+		par.EN_GPSZ = n;
+		EmulNet *en = new EmulNet(&par);
+		vector<Address> addrs(n);
+		for ( int i = 0; i < n; i++ ) {
+			en->ENinit(&addrs[i], par.PORTNUM);
+		}
+
+		double recvTime = 0;
+		double scanTime = 0;
+		long matched = 0;
+		vector<Address> buff;
+		received = 0;
+		for ( int tick = 0; tick < BENCH_TICKS; tick++ ) {
+			par.globaltime = tick;
+			buff.clear();
+			for ( int i = 0; i < n; i++ ) {
+				for ( int k = 0; k < BENCH_FANOUT; k++ ) {
+					Address &to = addrs[rand_r(&seed) % n];
+					en->ENsend(&addrs[i], &to, msg, sizeof(msg));
+					buff.push_back(to);
+				}
+			}
+			en->ENflush();
+
+			if ( tick < BENCH_SCAN_TICKS ) {
+				double start = now();
+				for ( int i = 0; i < n; i++ ) {
+					for ( unsigned int j = 0; j < buff.size(); j++ ) {
+						if ( memcmp(buff[j].addr, addrs[i].addr, sizeof(addrs[i].addr)) == 0 ) {
+							matched++;
+						}
+					}
+				}
+				scanTime += now() - start;
+			}
+
+			double start = now();
+			for ( int i = 0; i < n; i++ ) {
+				en->ENrecv(&addrs[i], consume, NULL, 1, en);
+			}
+			recvTime += now() - start;
+		}
+
+		printf("%8d %12d %14.1f %14.1f %14.1f\n", n, n * BENCH_FANOUT, recvTime / BENCH_TICKS, recvTime * 1000 / received,
+				scanTime / BENCH_SCAN_TICKS);
+		if ( matched != (long)n * BENCH_FANOUT * BENCH_SCAN_TICKS ) {
+			printf("scan matched %ld messages\n", matched);
+		}
+		delete en;
+	}
+	return 0;
+}
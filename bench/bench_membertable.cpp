@@ -0,0 +1,428 @@
+/**********************************
+ * FILE NAME: bench_membertable.cpp
+ *
+ * DESCRIPTION: Timings of the membership table against the vector of
+ * 				MemberListEntry it replaced, one section per operation:
+ * 				lookup finds every member of a received list, and sweep removes
+ * 				the members that timed out from tables of 10k to 100k entries.
+ * 				deadlines runs a table for 500 ticks of heartbeat news and compares
+ * 				three ways of finding the members that time out: a sweep every tick,
+ * 				a timing wheel of per-member deadlines, and a sweep skipped until
+ * 				the earliest deadline. merge applies a received
+ * 				list in one walk instead of entry by entry; before timing it, it is
+ * 				checked against the entry by entry outcome on random tables and
+ * 				lists, and a mismatch fails the run.
+ **********************************/
+
+#include "Member.h"
+#include "MemberTable.h"
+#include "TimerWheel.h"
+#include <chrono>
+
+static double now() {
+	return chrono::duration<double, micro>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * FUNCTION NAME: benchLookup
+ *
+ * DESCRIPTION: Find each member of a full list in a shuffled order, as addMember does for
+ * 				every entry received: a scan of the vector against MemberTable::find
+ */
+static void benchLookup() {
+	unsigned int seed = 1;
+
+	printf("lookup %8s %14s %14s %8s\n", "members", "scan us/list", "find us/list", "speedup");
+	int sizes[] = { 100, 1000, 10000 };
+	for ( int n : sizes ) {
+		vector<MemberListEntry> list;
+		MemberTable table;
+		for ( int i = 0; i < n; i++ ) {
+			list.push_back(MemberListEntry(i + 1, 0, 1000, 0));
+			table.add(i + 1, 0, 1000, 0, 0, 0);
+		}
+
+		vector<int> order(n);
+		for ( int i = 0; i < n; i++ ) {
+			order[i] = i + 1;
+		}
+		for ( int i = n - 1; i > 0; i-- ) {
+			swap(order[i], order[rand_r(&seed) % (i + 1)]);
+		}
+
+		int reps = max(1, 2000000 / n / n);
+		long found = 0;
+		double start = now();
+		for ( int r = 0; r < reps; r++ ) {
+			for ( int id : order ) {
+				for ( unsigned int k = 0; k < list.size(); k++ ) {
+					if ( list[k].id == id && list[k].port == 0 ) {
+						found++;
+						break;
+					}
+				}
+			}
+		}
+		double scan = (now() - start) / reps;
+
+		int findReps = reps * 100;
+		start = now();
+		for ( int r = 0; r < findReps; r++ ) {
+			for ( int id : order ) {
+				found += table.find(id, 0) >= 0;
+			}
+		}
+		double find = (now() - start) / findReps;
+
+		printf("       %8d %14.1f %14.2f %7.0fx%s\n", n, scan, find, scan / find,
+				found == (long)n * (reps + findReps) ? "" : "  (missed members)");
+	}
+}
+
+/**
+ * FUNCTION NAME: benchSweep
+ *
+ * DESCRIPTION: Remove the members past their timeout, as nodeLoopOps does every tick:
+ * 				an erase per removal; one pass compacting the vector and moving the
+ * 				slots of the entries it shifts in an index, as the sweep did until this
+ * 				table; and MemberTable::expired over the deadlines with removeAll
+ */
+static void benchSweep() {
+	const int reps = 3;
+	const int timeout = 25;
+	const int tick = 500;
+	vector<int> slots;
+
+	printf("sweep  %8s %8s %14s %14s %14s %8s\n", "members", "expired", "erase us", "compact us", "table us", "speedup");
+	int sizes[] = { 10000, 100000 };
+	int percents[] = { 0, 1 };
+	for ( int n : sizes ) {
+		for ( int pct : percents ) {
+			double erase = 0;
+			double compact = 0;
+			double sweep = 0;
+			long removedErase = 0;
+			long removedCompact = 0;
+			long removedTable = 0;
+			for ( int r = 0; r < reps; r++ ) {
+				unsigned int seed = r + 1;
+				vector<MemberListEntry> list;
+				unordered_map<long long, size_t> index;
+				MemberTable table;
+				for ( int i = 0; i < n; i++ ) {
+					long timestamp = ((int)(rand_r(&seed) % 100) < pct) ? 0 : tick;
+					list.push_back(MemberListEntry(i + 1, 0, timestamp, timestamp));
+					index[MemberTable::key(i + 1, 0)] = i;
+					table.add(i + 1, 0, timestamp, timestamp, 0, timeout);
+				}
+				vector<MemberListEntry> packed = list;
+
+				double start = now();
+				for ( auto member = list.begin(); member != list.end(); ) {
+					if ( tick - member->gettimestamp() >= timeout ) {
+						member = list.erase(member);
+						removedErase++;
+					} else {
+						++member;
+					}
+				}
+				erase += now() - start;
+
+				start = now();
+				size_t kept = 0;
+				for ( size_t i = 0; i < packed.size(); i++ ) {
+					long long k = MemberTable::key(packed[i].id, packed[i].port);
+					if ( tick - packed[i].gettimestamp() >= timeout ) {
+						index.erase(k);
+						removedCompact++;
+						continue;
+					}
+					if ( kept != i ) {
+						packed[kept] = packed[i];
+						index[k] = kept;
+					}
+					kept++;
+				}
+				packed.resize(kept);
+				compact += now() - start;
+
+				start = now();
+				slots.clear();
+				table.expired(tick, slots);
+				removedTable += slots.size();
+				table.removeAll(slots);
+				sweep += now() - start;
+			}
+			printf("       %8d %7d%% %14.1f %14.1f %14.1f %7.1fx%s\n", n, pct, erase / reps, compact / reps, sweep / reps,
+					compact / sweep, removedErase == removedCompact && removedCompact == removedTable ? "" : "  (removed counts differ)");
+		}
+	}
+}
+
+/**
+ * FUNCTION NAME: benchDeadlines
+ *
+ * DESCRIPTION: Every tick each member's heartbeat news arrives, either always or at random
+ * 				one tick in four, and the members past their timeout are found three ways
+ * 				on the same table: expired every tick; a TimerWheel holding one deadline
+ * 				per member, which on firing re-arms at the member's current deadline
+ * 				unless it has passed; and expired only once the tick reaches the earliest
+ * 				deadline the last sweep saw, as nodeLoopOps does. The
+ * 				members found are re-added at the current tick, so the table keeps its
+ * 				size, and all three must find the same number of them.
+ */
+static void benchDeadlines() {
+	const int timeout = 25;
+	const int ticks = 500;
+	vector<int> slots;
+
+	printf("deadline %8s %8s %10s %12s %12s %12s %8s\n", "members", "news", "expired", "sweep us", "wheel us",
+			"bounded us", "sweeps");
+	int sizes[] = { 10000, 100000 };
+	// news every tick, or one tick in four
+	int rates[] = { 1, 4 };
+	for ( int n : sizes ) {
+		for ( int every : rates ) {
+			unsigned int seed = 1;
+			MemberTable table;
+			TimerWheel<long long> wheel(0);
+			for ( int i = 0; i < n; i++ ) {
+				table.add(i + 1, 0, 0, 0, 0, timeout);
+				wheel.schedule(timeout, MemberTable::key(i + 1, 0));
+			}
+			long due = 0;
+			long sweeps = 0;
+			long foundSweep = 0;
+			long foundWheel = 0;
+			long foundBounded = 0;
+			double sweep = 0;
+			double wheelTime = 0;
+			double bounded = 0;
+			vector<int> expired;
+
+			for ( long tick = 1; tick <= ticks; tick++ ) {
+				for ( int i = 0; i < n; i++ ) {
+					if ( every == 1 || rand_r(&seed) % every == 0 ) {
+						table.timestamps[i] = tick;
+						table.deadlines[i] = tick + timeout;
+					}
+				}
+
+				double start = now();
+				slots.clear();
+				table.expired(tick, slots);
+				foundSweep += slots.size();
+				sweep += now() - start;
+				expired = slots;
+
+				start = now();
+				wheel.advance(tick, [&](long long key) {
+					int slot = table.find(key);
+					long deadline = table.deadlines[slot];
+					if ( deadline <= tick ) {
+						foundWheel++;
+					} else {
+						wheel.schedule(deadline, key);
+					}
+				});
+				wheelTime += now() - start;
+
+				start = now();
+				if ( tick >= due ) {
+					slots.clear();
+					due = table.expired(tick, slots);
+					foundBounded += slots.size();
+					sweeps++;
+				}
+				bounded += now() - start;
+
+				// Re-add what timed out, as a member joining again would be
+				for ( int slot : expired ) {
+					table.timestamps[slot] = tick;
+					table.deadlines[slot] = tick + timeout;
+					wheel.schedule(tick + timeout, MemberTable::key(table.ids[slot], table.ports[slot]));
+					due = min(due, tick + timeout);
+				}
+			}
+			printf("         %8d %8s %10.1f %12.1f %12.1f %12.1f %8ld%s\n", n, every == 1 ? "always" : "1 in 4",
+					(double)foundSweep / ticks, sweep / ticks, wheelTime / ticks, bounded / ticks, sweeps,
+					foundSweep == foundWheel && foundWheel == foundBounded ? "" : "  (found counts differ)");
+		}
+	}
+}
+
+/**
+ * FUNCTION NAME: checkMerge
+ *
+ * DESCRIPTION: Merge random lists into random tables and compare what merge reports
+ * 				with a find per entry: updated where the heartbeat is above both the
+ * 				member's and floor, added where the table does not hold the member,
+ * 				and nothing at all for a list out of key order
+ *
+ * RETURNS:
+ * number of lists where the two differ
+ */
+static long checkMerge(int lists) {
+	unsigned int seed = 7;
+	long mismatches = 0;
+	vector< pair<int, int> > updated, expectUpdated;
+	vector<int> added, expectAdded;
+
+	for ( int l = 0; l < lists; l++ ) {
+		// Ids a little sparse and a few ports, so runs of four both line up and break
+		MemberTable table;
+		vector<MemberListEntry> entries;
+		int span = 1 + rand_r(&seed) % 400;
+		for ( int id = 1; id <= span; id++ ) {
+			for ( short port = 0; port < 2; port++ ) {
+				if ( rand_r(&seed) % 4 != 0 ) {
+					entries.push_back(MemberListEntry(id, port, rand_r(&seed) % 50, 0));
+				}
+			}
+		}
+		table.insertAll(entries, 0);
+
+		vector<int> ids;
+		vector<short> ports;
+		vector<long> heartbeats;
+		for ( int id = 1; id <= span + 8; id++ ) {
+			for ( short port = 0; port < 2; port++ ) {
+				if ( rand_r(&seed) % 3 != 0 ) {
+					ids.push_back(id);
+					ports.push_back(port);
+					heartbeats.push_back(rand_r(&seed) % 60);
+				}
+			}
+		}
+		bool sorted = true;
+		if ( ids.size() > 1 && rand_r(&seed) % 20 == 0 ) {
+			int a = rand_r(&seed) % ids.size();
+			int b = rand_r(&seed) % ids.size();
+			swap(ids[a], ids[b]);
+			swap(ports[a], ports[b]);
+			sorted = (a == b);
+		}
+		long floor = rand_r(&seed) % 30;
+
+		expectUpdated.clear();
+		expectAdded.clear();
+		if ( sorted ) {
+			for ( unsigned int i = 0; i < ids.size(); i++ ) {
+				int slot = table.find(ids[i], ports[i]);
+				if ( slot < 0 ) {
+					expectAdded.push_back(i);
+				} else if ( heartbeats[i] > table.heartbeats[slot] && heartbeats[i] > floor ) {
+					expectUpdated.push_back(make_pair(slot, (int)i));
+				}
+			}
+		}
+
+		updated.clear();
+		added.clear();
+		bool merged = table.merge(ids.data(), ports.data(), heartbeats.data(), ids.size(), floor, updated, added);
+		if ( merged != sorted || updated != expectUpdated || added != expectAdded ) {
+			mismatches++;
+		}
+	}
+	return mismatches;
+}
+
+/**
+ * FUNCTION NAME: benchMerge
+ *
+ * DESCRIPTION: Apply a full list sorted by key, as heartbeat gossip sends it, to a table
+ * 				holding every member. Per entry, the addMember loop looked the member up
+ * 				and compared heartbeats: first in a hash index over the table, now with
+ * 				find on its slot map; merge does the whole list in one walk. Then a
+ * 				joiner taking in the whole list: add per entry against one insertAll.
+ */
+static void benchMerge() {
+	unsigned int seed = 1;
+	vector< pair<int, int> > updated;
+	vector<int> added;
+
+	printf("merge  %8s %14s %14s %14s\n", "members", "hash M/s", "find M/s", "merge M/s");
+	printf("insert %8s %14s %14s %8s\n", "members", "add us", "insertAll us", "speedup");
+	int sizes[] = { 200, 10000, 100000 };
+	for ( int n : sizes ) {
+		vector<MemberListEntry> entries;
+		vector<int> ids(n);
+		vector<short> ports(n, 0);
+		vector<long> heartbeats(n);
+		for ( int i = 0; i < n; i++ ) {
+			entries.push_back(MemberListEntry(i + 1, 0, 1000, 0));
+			ids[i] = i + 1;
+			heartbeats[i] = 1000 + rand_r(&seed) % 2;
+		}
+		vector<MemberListEntry> joiner = entries;
+		MemberTable table;
+		table.insertAll(entries, 0);
+		unordered_map<long long, int> index;
+		for ( int slot = 0; slot < n; slot++ ) {
+			index[MemberTable::key(table.ids[slot], table.ports[slot])] = slot;
+		}
+
+		int reps = max(4, 4000000 / n);
+		long newer = 0;
+		double start = now();
+		for ( int r = 0; r < reps; r++ ) {
+			for ( int i = 0; i < n; i++ ) {
+				auto found = index.find(MemberTable::key(ids[i], ports[i]));
+				if ( found != index.end() && heartbeats[i] > table.heartbeats[found->second] && heartbeats[i] > 900 ) {
+					newer++;
+				}
+			}
+		}
+		double hash = now() - start;
+
+		start = now();
+		for ( int r = 0; r < reps; r++ ) {
+			for ( int i = 0; i < n; i++ ) {
+				int slot = table.find(ids[i], ports[i]);
+				if ( slot >= 0 && heartbeats[i] > table.heartbeats[slot] && heartbeats[i] > 900 ) {
+					newer++;
+				}
+			}
+		}
+		double find = now() - start;
+
+		start = now();
+		for ( int r = 0; r < reps; r++ ) {
+			updated.clear();
+			added.clear();
+			table.merge(ids.data(), ports.data(), heartbeats.data(), n, 900, updated, added);
+			newer -= 2 * updated.size();
+		}
+		double merge = now() - start;
+
+		double total = (double)n * reps;
+		printf("merge  %8d %14.1f %14.1f %14.1f%s\n", n, total / hash, total / find, total / merge,
+				newer == 0 ? "" : "  (updates differ)");
+
+		MemberTable one, all;
+		start = now();
+		for ( int i = 0; i < n; i++ ) {
+			one.add(ids[i], 0, 1000, 0, 0, 0);
+		}
+		double add = now() - start;
+		start = now();
+		all.insertAll(joiner, 0);
+		double insert = now() - start;
+		printf("insert %8d %14.1f %14.1f %7.1fx\n", n, add, insert, add / insert);
+	}
+}
+
+int main() {
+	long lists = 50000;
+	long mismatches = checkMerge(lists);
+	printf("merge check: %ld lists, %ld mismatches\n", lists, mismatches);
+	if ( mismatches != 0 ) {
+		return 1;
+	}
+
+	benchLookup();
+	benchSweep();
+	benchDeadlines();
+	benchMerge();
+	return 0;
+}
@@ -0,0 +1,117 @@
+/**********************************
+ * FILE NAME: bench_wire.cpp
+ *
+ * DESCRIPTION: Encode and decode throughput of membership list entries, and how many
+ * 				fit 4000 bytes, in the raw layout lists used to have (int id, short
+ * 				port, long heartbeat, copied in host order) and in the entries layout
+ * 				of the wire format (id delta, port and heartbeat above the list's base,
+ * 				as varints). Heartbeats are spread over BENCH_SPREAD ticks, as in a
+ * 				group where everyone is heard from within a few ticks.
+ **********************************/
+
+#include "Wire.h"
+#include <chrono>
+
+#define BENCH_ENTRIES 1000
+#define BENCH_SPREAD 30
+#define BENCH_REPS 20000
+#define BENCH_ENVELOPE 4000
+
+// keeps the copies of the raw layout from being optimised away
+static volatile long sink;
+
+static double now() {
+	return chrono::duration<double, micro>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int main() {
+	unsigned int seed = 1;
+	vector<int> ids(BENCH_ENTRIES);
+	vector<short> ports(BENCH_ENTRIES, 0);
+	vector<long> heartbeats(BENCH_ENTRIES);
+	long base = 100000;
+	for ( int i = 0; i < BENCH_ENTRIES; i++ ) {
+		ids[i] = i + 1;
+		heartbeats[i] = base + rand_r(&seed) % BENCH_SPREAD;
+	}
+
+	const int rawEntry = sizeof(int) + sizeof(short) + sizeof(long);
+	vector<char> raw(BENCH_ENTRIES * rawEntry);
+	vector<char> wire(BENCH_ENTRIES * 3 * WIRE_MAX_VARINT);
+	vector<int> outIds(BENCH_ENTRIES);
+	vector<short> outPorts(BENCH_ENTRIES);
+	vector<long> outHeartbeats(BENCH_ENTRIES);
+	long check = 0;
+
+	double start = now();
+	for ( int r = 0; r < BENCH_REPS; r++ ) {
+		char *p = raw.data();
+		for ( int i = 0; i < BENCH_ENTRIES; i++ ) {
+			memcpy(p, &ids[i], sizeof(int));
+			memcpy(p + sizeof(int), &ports[i], sizeof(short));
+			memcpy(p + sizeof(int) + sizeof(short), &heartbeats[i], sizeof(long));
+			p += rawEntry;
+		}
+		check += raw[r % raw.size()];
+	}
+	double rawEncode = now() - start;
+
+	start = now();
+	for ( int r = 0; r < BENCH_REPS; r++ ) {
+		const char *p = raw.data();
+		for ( int i = 0; i < BENCH_ENTRIES; i++ ) {
+			memcpy(&outIds[i], p, sizeof(int));
+			memcpy(&outPorts[i], p + sizeof(int), sizeof(short));
+			memcpy(&outHeartbeats[i], p + sizeof(int) + sizeof(short), sizeof(long));
+			p += rawEntry;
+		}
+		check += outHeartbeats[r % BENCH_ENTRIES];
+	}
+	double rawDecode = now() - start;
+
+	int wireSize = 0;
+	start = now();
+	for ( int r = 0; r < BENCH_REPS; r++ ) {
+		WireWriter out(wire.data(), wire.size());
+		int previd = 0;
+		for ( int i = 0; i < BENCH_ENTRIES; i++ ) {
+			out.putSVarint(ids[i] - previd);
+			out.putSVarint(ports[i]);
+			out.putVarint(heartbeats[i] - base);
+			previd = ids[i];
+		}
+		wireSize = out.size();
+	}
+	double wireEncode = now() - start;
+
+	bool decoded = true;
+	start = now();
+	for ( int r = 0; r < BENCH_REPS; r++ ) {
+		WireReader in(wire.data(), wireSize);
+		int id = 0;
+		for ( int i = 0; i < BENCH_ENTRIES; i++ ) {
+			id += (int)in.getSVarint();
+			outIds[i] = id;
+			outPorts[i] = (short)in.getSVarint();
+			outHeartbeats[i] = base + (long)in.getVarint();
+		}
+		decoded = decoded && in.ok();
+		check += outHeartbeats[r % BENCH_ENTRIES];
+	}
+	double wireDecode = now() - start;
+
+	decoded = decoded && outIds == ids && outPorts == ports && outHeartbeats == heartbeats;
+
+	double entries = (double)BENCH_ENTRIES * BENCH_REPS;
+	printf("%6s %14s %16s %16s %16s\n", "layout", "bytes/entry", "encode M/s", "decode M/s", "per 4000 bytes");
+	printf("%6s %14.2f %16.1f %16.1f %16d\n", "raw", (double)rawEntry, entries / rawEncode, entries / rawDecode,
+			BENCH_ENVELOPE / rawEntry);
+	printf("%6s %14.2f %16.1f %16.1f %16d\n", "wire", (double)wireSize / BENCH_ENTRIES, entries / wireEncode,
+			entries / wireDecode, (int)((long)BENCH_ENVELOPE * BENCH_ENTRIES / wireSize));
+	if ( !decoded ) {
+		printf("wire entries did not decode to what was encoded\n");
+		return 1;
+	}
+	sink = check;
+	return 0;
+}
@@ -0,0 +1,109 @@
+/**********************************
+ * FILE NAME: check_timerwheel.cpp
+ *
+ * DESCRIPTION: Checks TimerWheel against a multimap keyed by due tick. Items are
+ * 				scheduled with delays from a tick up to past the range of the first
+ * 				levels, and some for ticks already reached; the wheel is advanced a
+ * 				tick at a time and, as the event-driven engine does, by longer jumps.
+ * 				After every advance the items fired must be the ones the multimap
+ * 				holds up to that tick, each fired at its own due tick, or at the
+ * 				start of the advance when it was already overdue. A mismatch fails the run.
+ **********************************/
+
+#include "TimerWheel.h"
+
+#define CHECK_STEPS 400000
+#define CHECK_RATE 4
+
+static long now;
+// due tick of each item, and whether it was overdue when scheduled
+static vector<long> due;
+static vector<bool> overdue;
+static vector<long> fired;
+static long late;
+
+/**
+ * FUNCTION NAME: fire
+ *
+ * DESCRIPTION: Note the item fired, and whether the wheel fired it on the tick it was due
+ */
+static void fire(TimerWheel<long> &wheel, long item) {
+	fired.push_back(item);
+	long expect = overdue[item] ? now : due[item];
+	if ( wheel.getNow() != expect ) {
+		late++;
+	}
+}
+
+/**
+ * FUNCTION NAME: delay
+ *
+ * DESCRIPTION: Mostly the few ticks of a link latency, sometimes far enough to go through
+ * 				each level above the first, and now and then a tick already reached
+ */
+static long delay(unsigned int *seed) {
+	int pick = rand_r(seed) % 100;
+	if ( pick < 60 ) {
+		return rand_r(seed) % 8;
+	}
+	if ( pick < 85 ) {
+		return rand_r(seed) % (2 * WHEEL_SLOTS);
+	}
+	if ( pick < 97 ) {
+		return rand_r(seed) % (WHEEL_SLOTS * WHEEL_SLOTS + WHEEL_SLOTS);
+	}
+	if ( pick < 99 ) {
+		return rand_r(seed) % (1L << 21);
+	}
+	return -(long)(rand_r(seed) % 4);
+}
+
+int main() {
+	unsigned int seed = 1;
+	TimerWheel<long> wheel(0);
+	multimap<long, long> reference;
+	long mismatches = 0;
+	long maxHeld = 0;
+	vector<long> expect;
+
+	now = 0;
+	for ( int step = 0; step < CHECK_STEPS; step++ ) {
+		int count = rand_r(&seed) % (2 * CHECK_RATE + 1);
+		for ( int i = 0; i < count; i++ ) {
+			long item = due.size();
+			long when = now + delay(&seed);
+			due.push_back(when);
+			overdue.push_back(when <= now);
+			wheel.schedule(when, item);
+			reference.insert(make_pair(when, item));
+		}
+		maxHeld = max(maxHeld, wheel.size());
+
+		// Mostly the next tick, now and then a jump of up to a thousand ticks
+		long to = now + (rand_r(&seed) % 100 ? 1 : 1 + rand_r(&seed) % 1000);
+		fired.clear();
+		wheel.advance(to, [&wheel](long item) { fire(wheel, item); });
+		now = to;
+
+		expect.clear();
+		while ( !reference.empty() && reference.begin()->first <= to ) {
+			expect.push_back(reference.begin()->second);
+			reference.erase(reference.begin());
+		}
+		sort(fired.begin(), fired.end());
+		sort(expect.begin(), expect.end());
+		if ( fired != expect || wheel.size() != (long)reference.size() ) {
+			mismatches++;
+		}
+	}
+
+	long left = 0;
+	wheel.drain([&left](long item) { left++; });
+	if ( left != (long)reference.size() || wheel.size() != 0 ) {
+		mismatches++;
+	}
+
+	printf("timer wheel check: %ld items over %ld ticks, up to %ld held, %ld mismatches, %ld fired off their tick\n",
+			(long)due.size(), now, maxHeld, mismatches, late);
+	return mismatches != 0 || late != 0;
+}